@@ -0,0 +1,461 @@
+// Microbenchmarks for the DSP building blocks in util/.
+//
+//   terrarium_bench [options]
+//
+//   --filter <text>     only run cases whose name contains text
+//   --samples <n>       samples per run (default 48000, 4800 on the M7)
+//   --repeat <n>        timed runs per case (default 15)
+//   --json <file>       also write the results as JSON (host only)
+//
+// Every case processes a buffer of prepared input so nothing folds away at
+// compile time. One untimed run warms caches and branch predictors, then the
+// median of the timed runs is reported per sample, along with the fastest
+// run, and per two-sample firmware block. On the host that is host time in
+// ns, which ranks the cases against each other. Built with
+// TERRARIUM_BENCH_CORTEX_M7 for the target, it is core cycles from the DWT
+// cycle counter, printed on the console; see BenchClock.h.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numbers>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <util/Controls.h>
+#include <util/Convolver.h>
+#include <util/EffectState.h>
+#include <util/Echo.h>
+#include <util/LinearRamp.h>
+#include <util/Mapping.h>
+#include <util/NoiseSynth.h>
+#include <util/PLL.h>
+#include <util/PolyTracker.h>
+#include <util/Resynthesizer.h>
+#include <util/SvFilter.h>
+#include <util/WaveSynth.h>
+
+#include "BenchClock.h"
+
+namespace
+{
+
+constexpr float sample_rate = 48000.0f;
+
+// Results are folded into this so the work can't be discarded.
+volatile float sink = 0.0f;
+
+// For cases whose per-sample result is object state rather than a value:
+// makes the compiler assume the object is read, so no iteration is dropped.
+template <typename T>
+void KeepState(T& object)
+{
+    asm volatile("" : : "r"(&object) : "memory");
+}
+
+struct Case
+{
+    std::string name;
+    // Processes the whole input and returns something derived from every
+    // output sample.
+    std::function<float(const std::vector<float>&)> run;
+    // Runs untimed before every run, for state that takes longer to set up
+    // than the work being measured.
+    std::function<void()> setup = [] {};
+};
+
+struct Result
+{
+    std::string name;
+    // Per sample, in bench_clock::unit.
+    double median = 0.0;
+    double min = 0.0;
+};
+
+// A plucked-string-like test signal: a decaying low E with harmonics and a
+// little noise, re-plucked every half second.
+std::vector<float> MakeInput(size_t samples)
+{
+    std::vector<float> input(samples);
+    std::minstd_rand random{1};
+    std::uniform_real_distribution<float> noise(-0.002f, 0.002f);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        const float t = static_cast<float>(i % 24000) / sample_rate;
+        const float phase = 2.0f * std::numbers::pi_v<float> * 82.4f * t;
+        const float decay = std::exp(-3.0f * t);
+        input[i] = decay * ((0.3f * std::sin(phase)) + (0.1f * std::sin(2.0f * phase)))
+            + noise(random);
+    }
+    return input;
+}
+
+std::vector<Case> MakeCases()
+{
+    std::vector<Case> cases;
+
+    cases.push_back({"SvFilter::update", [](const auto& input) {
+        SvFilter filter{800_Hz, sample_rate, 2.0f};
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            filter.update(x);
+            sum += filter.lowPass();
+        }
+        return sum;
+    }});
+
+    cases.push_back({"SvFilter::config", [](const auto& input) {
+        SvFilter filter;
+        for (const float x : input)
+        {
+            filter.config((1000.0f + (2000.0f * x)) * 1_Hz, sample_rate, 1.2f);
+            KeepState(filter);
+        }
+        filter.update(1.0f);
+        return filter.lowPass();
+    }});
+
+    cases.push_back({"SvFilter::configNormalized", [](const auto& input) {
+        SvFilter filter;
+        constexpr float sample_period = 1.0f / sample_rate;
+        for (const float x : input)
+        {
+            filter.configNormalized((1000.0f + (2000.0f * x)) * sample_period, 1.2f);
+            KeepState(filter);
+        }
+        filter.update(1.0f);
+        return filter.lowPass();
+    }});
+
+    cases.push_back({"WaveSynth::operator()", [](const auto& input) {
+        WaveSynth synth{1.5f};
+        q::phase_iterator phase;
+        phase.set(110_Hz, sample_rate);
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += synth(phase++) + x;
+        }
+        return sum;
+    }});
+
+    cases.push_back({"WaveSynth::setShape", [](const auto& input) {
+        WaveSynth synth;
+        for (const float x : input)
+        {
+            synth.setShape(1.5f + (3.0f * x));
+            KeepState(synth);
+        }
+        return synth(q::frac_to_phase(0.3f));
+    }});
+
+    cases.push_back({"LogMapping", [](const auto& input) {
+        constexpr LogMapping mapping{0.0001f, 0.05f, 0.4f};
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += mapping(0.5f + x);
+        }
+        return sum;
+    }});
+
+    cases.push_back({"LinearMapping", [](const auto& input) {
+        constexpr LinearMapping mapping{64.0f, 3200.0f};
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += mapping(0.5f + x);
+        }
+        return sum;
+    }});
+
+    cases.push_back({"LinearRamp", [](const auto& input) {
+        LinearRamp ramp{0.0f, 0.0025f};
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += ramp(x > 0.0f ? 1.0f : 0.0f);
+        }
+        return sum;
+    }});
+
+    cases.push_back({"NoiseSynth", [](const auto& input) {
+        NoiseSynth noise;
+        noise.setSampleDuration(4.0f);
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += noise() + x;
+        }
+        return sum;
+    }});
+
+    cases.push_back({"Fuzz::Process", [](const auto& input) {
+        Fuzz fuzz;
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += fuzz.Process(x * 4.0f, 0.05f);
+        }
+        return sum;
+    }});
+
+    cases.push_back({"EffectState accessors", [](const auto& input) {
+        EffectState state;
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            const float ratio = 0.5f + x;
+            state.setDryRatio(ratio);
+            state.setSynthRatio(ratio);
+            state.setWaveRatio(ratio);
+            state.setFilterRatio(ratio);
+            state.setResonanceRatio(ratio);
+            sum += state.dryLevel() + state.synthLevel() + state.waveShape()
+                + state.resonance() + state.lowPassCorner(110.0f)
+                + state.highPassCorner(110.0f) + state.noiseSampleDuration(110.0f);
+        }
+        return sum;
+    }});
+
+    // Two-sample blocks as in the firmware, so the per-block transfers are
+    // counted at their real rate.
+    static Echo echo;
+    cases.push_back({"Echo::Process", [](const auto& input) {
+        std::vector<float> block(input);
+        float sum = 0.0f;
+        for (size_t i = 0; i < block.size(); i += 2)
+        {
+            const size_t size = std::min<size_t>(2, block.size() - i);
+            echo.Process(&block[i], size);
+            sum += block[i];
+        }
+        return sum;
+    }, [] {
+        // Clearing the line touches all of it.
+        echo.Init(sample_rate);
+        echo.SetDelayMs(375);
+        echo.SetLevel(0.35f);
+    }});
+
+    // Against the response length, in firmware blocks.
+    for (const size_t taps : {256, 512, 1024, 2048})
+    {
+        static Convolver convolver;
+        const auto run = [](const auto& input) {
+            std::vector<float> block(input);
+            float sum = 0.0f;
+            for (size_t i = 0; i < block.size(); i += 2)
+            {
+                const size_t size = std::min<size_t>(2, block.size() - i);
+                convolver.Process(&block[i], size);
+                sum += block[i];
+            }
+            return sum;
+        };
+        // The response is resampled and transformed once per load, which
+        // the firmware does outside the audio callback.
+        const auto setup = [taps] {
+            // Decaying noise, shaped like a cabinet response.
+            std::minstd_rand random{2};
+            std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+            std::vector<float> response(taps);
+            for (size_t i = 0; i < taps; ++i)
+            {
+                response[i] = std::exp(-8.0f * static_cast<float>(i) / static_cast<float>(taps)) * noise(random);
+            }
+            convolver.Init(sample_rate);
+            convolver.SetImpulseResponse(response.data(), taps, sample_rate);
+        };
+        cases.push_back({"Convolver " + std::to_string(taps) + " taps", run, setup});
+    }
+
+    cases.push_back({"PolyTracker::Process", [](const auto& input) {
+        PolyTracker tracker;
+        tracker.Init(sample_rate);
+        tracker.SetShape(1.5f);
+        float sum = 0.0f;
+        for (const float x : input)
+        {
+            sum += tracker.Process(x);
+        }
+        return sum;
+    }});
+
+    for (const size_t harmonics : {4, 8, 16})
+    {
+        cases.push_back({"Resynthesizer " + std::to_string(harmonics) + " harmonics", [harmonics](const auto& input) {
+            Resynthesizer resynthesizer;
+            resynthesizer.Init(sample_rate);
+            resynthesizer.SetHarmonics(harmonics);
+            resynthesizer.SetFundamental(110.0f, 220.0f);
+            const auto increment = static_cast<uint32_t>(220.0f / sample_rate * 4294967296.0f);
+            uint32_t phase = 0;
+            float sum = 0.0f;
+            for (const float x : input)
+            {
+                sum += resynthesizer.Process(x, phase);
+                phase += increment;
+            }
+            return sum;
+        }});
+    }
+
+    using Configure = void (*)(PLL::Params&);
+    const auto pll_case = [](bool track, Configure configure) {
+        return [track, configure](const std::vector<float>& input) {
+            PLL pll;
+            pll.Init(sample_rate);
+            PLL::Params params = DefaultParams();
+            float output_level = 0.0f;
+            ControlState controls{};
+            controls.knobs = {0.3f, 0.6f, 0.5f, 0.3f, 0.7f, 0.8f};
+            controls.toggles = {true, true, true, false};
+            ApplyControlState(controls, params, output_level);
+            configure(params);
+            pll.SetParams(params);
+
+            float sum = 0.0f;
+            for (size_t i = 0; i < input.size(); i += 2)
+            {
+                pll.BeginBlock(2);
+                for (size_t j = i; j < std::min(i + 2, input.size()); ++j)
+                {
+                    if (track)
+                    {
+                        pll.Track(input[j]);
+                    }
+                    else
+                    {
+                        sum += pll.Process(input[j]);
+                    }
+                }
+            }
+            return sum + (pll.Locked() ? 1.0f : 0.0f);
+        };
+    };
+    const Configure defaults = [](PLL::Params&) {};
+    cases.push_back({"PLL::Process", pll_case(false, defaults)});
+    cases.push_back({"PLL::Process resynthesis", pll_case(false, [](PLL::Params& params) {
+        params.resynthesis = true;
+    })});
+    cases.push_back({"PLL::Track", pll_case(true, defaults)});
+    cases.push_back({"PLL::Track quadrature", pll_case(true, [](PLL::Params& params) {
+        params.quadrature_detector = true;
+    })});
+
+    return cases;
+}
+
+Result Measure(const Case& bench, const std::vector<float>& input, int repeat)
+{
+    bench.setup();
+    sink = sink + bench.run(input);
+
+    std::vector<double> runs;
+    for (int i = 0; i < repeat; ++i)
+    {
+        bench.setup();
+        const auto start = bench_clock::Now();
+        sink = sink + bench.run(input);
+        const auto end = bench_clock::Now();
+        runs.push_back(bench_clock::Elapsed(start, end) / static_cast<double>(input.size()));
+    }
+
+    std::sort(runs.begin(), runs.end());
+    return {bench.name, runs[runs.size() / 2], runs.front()};
+}
+
+// The firmware runs two-sample audio blocks.
+constexpr double block_samples = 2.0;
+
+#ifndef TERRARIUM_BENCH_CORTEX_M7
+// Bare metal has no files; the console output is all there is.
+void WriteJson(const std::string& path, const std::vector<Result>& results, size_t samples, int repeat)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write '%s'\n", path.c_str());
+        return;
+    }
+
+    fprintf(file, "{\n  \"samples\": %zu,\n  \"repeat\": %d,\n  \"results\": [\n",
+        samples, repeat);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        fprintf(file, "    {\"name\": \"%s\", \"ns_per_sample\": %.3f, \"min_ns_per_sample\": %.3f, "
+            "\"ns_per_block\": %.1f}%s\n",
+            result.name.c_str(), result.median, result.min,
+            result.median * block_samples,
+            (i + 1 < results.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+#endif
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string json_path;
+#ifdef TERRARIUM_BENCH_CORTEX_M7
+    // The inputs and outputs have to fit the internal SRAM.
+    size_t samples = 4800;
+#else
+    size_t samples = 48000;
+#endif
+    int repeat = 15;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto next = [&]() -> std::string {
+            return (i + 1 < argc) ? argv[++i] : "";
+        };
+
+        if (arg == "--filter") filter = next();
+        else if (arg == "--samples") samples = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--repeat") repeat = std::max(1, std::atoi(next().c_str()));
+#ifndef TERRARIUM_BENCH_CORTEX_M7
+        else if (arg == "--json") json_path = next();
+#endif
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter text] [--samples n] [--repeat n] [--json file]\n",
+                argv[0]);
+            return 1;
+        }
+    }
+
+    bench_clock::Init();
+    const auto input = MakeInput(samples);
+    std::vector<Result> results;
+    for (const auto& bench : MakeCases())
+    {
+        if (!filter.empty() && bench.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        results.push_back(Measure(bench, input, repeat));
+        const auto& result = results.back();
+        printf("%-28s %9.2f %s/sample (min %.2f) %9.1f %s/block\n",
+            result.name.c_str(), result.median, bench_clock::unit, result.min,
+            result.median * block_samples, bench_clock::unit);
+    }
+
+#ifndef TERRARIUM_BENCH_CORTEX_M7
+    if (!json_path.empty())
+    {
+        WriteJson(json_path, results, samples, repeat);
+    }
+#endif
+    return 0;
+}
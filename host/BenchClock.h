@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+
+// Time source of terrarium_bench. On the host this is steady_clock in ns.
+// Built with TERRARIUM_BENCH_CORTEX_M7 it is the core's DWT cycle counter,
+// so the results are core cycles whatever the clock is set to.
+#ifdef TERRARIUM_BENCH_CORTEX_M7
+
+namespace bench_clock
+{
+
+constexpr const char* unit = "cycles";
+
+inline volatile uint32_t& Register(uintptr_t address)
+{
+    return *reinterpret_cast<volatile uint32_t*>(address);
+}
+
+inline void Init()
+{
+    auto& demcr = Register(0xE000EDFC);
+    auto& dwt_ctrl = Register(0xE0001000);
+    demcr = demcr | (1u << 24);         // enable the trace blocks
+    Register(0xE0001FB0) = 0xC5ACCE55;  // DWT lock access, needed on the M7
+    Register(0xE0001004) = 0;           // CYCCNT
+    dwt_ctrl = dwt_ctrl | 1u;           // start CYCCNT
+}
+
+// 32 bits wrap after about 9 s at 480 MHz; keep single runs shorter.
+inline uint32_t Now()
+{
+    return Register(0xE0001004);
+}
+
+inline double Elapsed(uint32_t start, uint32_t end)
+{
+    return static_cast<double>(end - start);
+}
+
+} // namespace bench_clock
+
+#else
+
+#include <chrono>
+
+namespace bench_clock
+{
+
+constexpr const char* unit = "ns";
+
+inline void Init()
+{
+}
+
+inline std::chrono::steady_clock::time_point Now()
+{
+    return std::chrono::steady_clock::now();
+}
+
+inline double Elapsed(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+} // namespace bench_clock
+
+#endif
@@ -0,0 +1,390 @@
+// Replays a capture dump through the firmware's signal chain on the host.
+//
+//   terrarium_replay [--output <file.wav>] [--ir <file.wav>] <dump.txt>
+//
+// The dump is the console output of Capture::Dump(); anything around it is
+// ignored, and the last dump in the file wins. Replay starts at the first
+// keyframe inside the recorded audio, with the PLL freshly reset, and applies
+// every logged control change at the block it was logged before, and bypass
+// changes at the sample they took effect. The same dump always renders the
+// same output, and the printed hash makes that easy to check across builds.
+//
+// The cabinet response lives in flash rather than in the dump, so a capture
+// made with one needs the same response given with --ir; Replay warns when
+// the tap counts disagree.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <util/Capture.h>
+#include <util/Controls.h>
+#include <util/Convolver.h>
+#include <util/Echo.h>
+#include <util/LinearRamp.h>
+#include <util/PLL.h>
+#include <util/Tuning.h>
+
+#include "Wav.h"
+
+namespace
+{
+
+struct CaptureDump
+{
+    uint32_t version = 0;
+    uint32_t sample_rate = 0;
+    uint32_t block_size = 0;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    std::vector<Capture::Event> events;
+    std::vector<float> audio;
+};
+
+float FromBits(unsigned long bits)
+{
+    const auto raw = static_cast<uint32_t>(bits);
+    float value;
+    std::memcpy(&value, &raw, sizeof(value));
+    return value;
+}
+
+bool LoadDump(const std::string& path, CaptureDump& dump)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    bool in_dump = false;
+    bool complete = false;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        unsigned version;
+        unsigned long rate, block, start, end;
+        if (sscanf(line.c_str(), "CAPTURE %u rate=%lu block=%lu start=%lu end=%lu",
+                &version, &rate, &block, &start, &end) == 5)
+        {
+            dump = CaptureDump{};
+            dump.version = version;
+            dump.sample_rate = static_cast<uint32_t>(rate);
+            dump.block_size = static_cast<uint32_t>(block);
+            dump.start = static_cast<uint32_t>(start);
+            dump.end = static_cast<uint32_t>(end);
+            in_dump = true;
+            complete = false;
+            continue;
+        }
+        if (!in_dump)
+        {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string tag;
+        fields >> tag;
+        if (tag == "E")
+        {
+            unsigned long sample, bits, value;
+            unsigned type, index;
+            fields >> sample >> type >> index >> bits >> std::hex >> value;
+            dump.events.push_back(Capture::Event{
+                static_cast<uint32_t>(sample),
+                static_cast<Capture::EventType>(type),
+                static_cast<uint8_t>(index),
+                static_cast<uint16_t>(bits),
+                FromBits(value)});
+        }
+        else if (tag == "A")
+        {
+            unsigned long sample, value;
+            fields >> sample >> std::hex;
+            if (sample != dump.start + dump.audio.size())
+            {
+                fprintf(stderr, "Audio gap at sample %lu\n", sample);
+                return false;
+            }
+            while (fields >> value)
+            {
+                dump.audio.push_back(FromBits(value));
+            }
+        }
+        else if (tag == "END")
+        {
+            // Bypass changes reach the log a control tick after they
+            // happen, so they can follow later control changes.
+            std::stable_sort(dump.events.begin(), dump.events.end(), [](const auto& a, const auto& b) {
+                return a.sample < b.sample;
+            });
+            in_dump = false;
+            complete = true;
+        }
+    }
+    return complete && dump.block_size > 0;
+}
+
+uint64_t Fnv1a(uint64_t hash, float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (int i = 0; i < 4; ++i)
+    {
+        hash = (hash ^ ((bits >> (8 * i)) & 0xFF)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// Control state as the firmware's loop last saw it.
+struct ReplayState
+{
+    ControlState live{};
+    ControlState saved{};
+    float morph = 0.0f;
+    bool effect_enabled = true;
+    bool endpoints_dirty = true;
+    uint8_t voice_mode = 0;
+    Tuning tuning{};
+    size_t cabinet_taps = 0;
+};
+
+// The firmware's base_params for the voice mode and tuning.
+PLL::Params BaseParams(const ReplayState& state)
+{
+    PLL::Params params = DefaultParams();
+    ApplyVoiceMode(state.voice_mode, params);
+    ApplyTuning(state.tuning, params);
+    return params;
+}
+
+void ApplyEvent(const Capture::Event& event, ReplayState& state, PLL& pll, Echo& echo)
+{
+    using Type = Capture::EventType;
+    const auto toggles = [&](ControlState& s) {
+        for (size_t i = 0; i < s.toggles.size(); ++i)
+        {
+            s.toggles[i] = (event.bits >> i) & 1;
+        }
+    };
+
+    switch (event.type)
+    {
+        case Type::LiveKnob: state.live.knobs[event.index] = event.value; break;
+        case Type::LiveToggles: toggles(state.live); break;
+        case Type::SavedKnob: state.saved.knobs[event.index] = event.value; break;
+        case Type::SavedToggles: toggles(state.saved); break;
+        case Type::Morph: state.morph = event.value; break;
+        case Type::Bypass: state.effect_enabled = (event.bits != 0); break;
+        case Type::LfoPeriod:
+            // The echo repeats at the tapped tempo too.
+            pll.SetLfoPeriodMs(static_cast<uint32_t>(event.value));
+            echo.SetDelayMs(static_cast<uint32_t>(event.value));
+            break;
+        case Type::LfoSync: pll.SyncLfo(); break;
+        case Type::EchoLevel: echo.SetLevel(event.value); break;
+        case Type::EchoFeedback: echo.SetFeedback(event.value); break;
+        case Type::VoiceMode: state.voice_mode = static_cast<uint8_t>(event.bits); break;
+        case Type::TuningField:
+            if (event.index < Capture::tuning_fields)
+            {
+                Capture::SetTuningField(state.tuning, event.index, event.value);
+            }
+            break;
+        case Type::CabinetTaps: state.cabinet_taps = static_cast<size_t>(event.value); break;
+        case Type::Keyframe:
+        case Type::StompRise:
+        case Type::StompFall:
+            break;
+    }
+    state.endpoints_dirty = true;
+}
+
+// Only one Echo may exist, and the convolver is too big for the stack.
+Echo echo;
+Convolver cabinet;
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string output_path;
+    std::string ir_path;
+    std::string dump_path;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--output" && i + 1 < argc) output_path = argv[++i];
+        else if (arg == "--ir" && i + 1 < argc) ir_path = argv[++i];
+        else dump_path = arg;
+    }
+
+    CaptureDump dump;
+    if (dump_path.empty() || !LoadDump(dump_path, dump))
+    {
+        fprintf(stderr, "usage: %s [--output <file.wav>] [--ir <file.wav>] <dump.txt>\n", argv[0]);
+        return 1;
+    }
+    if (dump.version < 2)
+    {
+        fprintf(stderr, "Warning: version %u dump without echo, voice mode and tuning; "
+            "the output will differ where they were in use\n", static_cast<unsigned>(dump.version));
+    }
+
+    const auto keyframe = std::find_if(dump.events.begin(), dump.events.end(), [&](const auto& e) {
+        return e.type == Capture::EventType::Keyframe && e.sample >= dump.start;
+    });
+    if (keyframe == dump.events.end())
+    {
+        fprintf(stderr, "No keyframe inside the captured audio\n");
+        return 1;
+    }
+
+    const auto rate = static_cast<float>(dump.sample_rate);
+    PLL pll;
+    pll.Init(rate);
+    echo.Init(rate);
+    cabinet.Init(rate);
+    if (!ir_path.empty())
+    {
+        // Cut where the firmware's flash slot does.
+        std::vector<float> taps;
+        uint32_t ir_rate = 0;
+        if (!ReadWav(ir_path, taps, &ir_rate) || taps.empty())
+        {
+            fprintf(stderr, "Could not read '%s'\n", ir_path.c_str());
+            return 1;
+        }
+        taps.resize(std::min(taps.size(), Convolver::max_taps));
+        cabinet.SetImpulseResponse(taps.data(), taps.size(), static_cast<float>(ir_rate));
+    }
+
+    ReplayState state;
+    const float fade_step = 1000.0f / (bypass_crossfade_ms * dump.sample_rate);
+    LinearRamp bypass_fade{0.0f, fade_step};
+    PLL::Params base_params = BaseParams(state);
+    DerivedState live_derived{};
+    DerivedState saved_derived{};
+    bool cabinet_warned = false;
+    auto next_event = keyframe;
+
+    std::vector<float> output;
+    std::vector<float> wet(dump.block_size);
+    bool wet_stages_idle = false;
+    uint64_t hash = 0xcbf29ce484222325ull;
+    const uint32_t first = keyframe->sample;
+    const uint32_t end = dump.start + static_cast<uint32_t>(dump.audio.size());
+
+    // Mirrors the control loop, processAudioBlock() and RenderAudio() in
+    // main.cpp. The PLL and the echo line start out empty, so the first
+    // moments after the keyframe can differ.
+    for (uint32_t block = first; block + dump.block_size <= end; block += dump.block_size)
+    {
+        while (next_event != dump.events.end() && next_event->sample <= block)
+        {
+            ApplyEvent(*next_event++, state, pll, echo);
+        }
+        if (block == first)
+        {
+            // Start settled, as the firmware was when it wrote the keyframe.
+            bypass_fade = LinearRamp{state.effect_enabled ? 1.0f : 0.0f, fade_step};
+        }
+        if (state.cabinet_taps != cabinet.Taps() && !cabinet_warned)
+        {
+            cabinet_warned = true;
+            fprintf(stderr, "Warning: the capture ran a %zu tap cabinet and the replay %zu taps; "
+                "pass the same response with --ir\n", state.cabinet_taps, cabinet.Taps());
+        }
+
+        if (state.endpoints_dirty)
+        {
+            state.endpoints_dirty = false;
+            base_params = BaseParams(state);
+            live_derived = Derive(state.live, base_params);
+            saved_derived = Derive(state.saved, base_params);
+        }
+        const DerivedState active = blended(live_derived, saved_derived, state.morph);
+        pll.SetParams(active.params);
+
+        pll.BeginBlock(dump.block_size);
+        uint32_t begin = 0;
+        while (begin < dump.block_size)
+        {
+            // A bypass switch splits the block, as in processAudioBlock().
+            while (next_event != dump.events.end() && next_event->sample <= block + begin)
+            {
+                ApplyEvent(*next_event++, state, pll, echo);
+            }
+            uint32_t span_end = dump.block_size;
+            if (next_event != dump.events.end() && next_event->sample < block + dump.block_size)
+            {
+                span_end = next_event->sample - block;
+            }
+
+            const float* dry = &dump.audio[block + begin - dump.start];
+            const size_t size = span_end - begin;
+            const bool bypassed = !state.effect_enabled && bypass_fade.Value() <= 0.0f;
+            if (bypassed)
+            {
+                if (!wet_stages_idle)
+                {
+                    echo.Reset();
+                    cabinet.Reset();
+                    wet_stages_idle = true;
+                }
+                for (size_t i = 0; i < size; ++i)
+                {
+                    pll.Track(dry[i]);
+                }
+            }
+            else
+            {
+                wet_stages_idle = false;
+                for (size_t i = 0; i < size; ++i)
+                {
+                    const float mixed_signal = pll.Process(dry[i]);
+                    wet[i] = (mixed_signal * active.output_level * final_output_trim);
+                }
+                echo.Process(wet.data(), size);
+                if (cabinet.Active())
+                {
+                    cabinet.Process(wet.data(), size);
+                }
+            }
+
+            for (size_t i = 0; i < size; ++i)
+            {
+                float out = dry[i];
+                if (!bypassed)
+                {
+                    const float fade = bypass_fade(state.effect_enabled ? 1.0f : 0.0f);
+                    out = std::lerp(dry[i], wet[i], fade);
+                }
+                out = std::clamp(out, -1.0f, 1.0f);
+
+                hash = Fnv1a(hash, out);
+                output.push_back(out);
+            }
+            begin = span_end;
+        }
+    }
+
+    if (!output_path.empty())
+    {
+        WriteWav(output_path, output, dump.sample_rate);
+    }
+
+    printf("Replayed %.3f s from sample %lu, %zu events\n",
+        output.size() / static_cast<double>(dump.sample_rate),
+        static_cast<unsigned long>(first),
+        static_cast<size_t>(next_event - keyframe));
+    printf("Output hash %016llx\n", static_cast<unsigned long long>(hash));
+    return 0;
+}
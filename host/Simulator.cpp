@@ -0,0 +1,468 @@
+// Runs the real firmware main() on the host against the libDaisy stand-ins.
+//
+//   terrarium_sim [options] <timeline>
+//
+//   --input <file.wav|sine:HZ|pluck:HZ:SECONDS|silence>   audio input
+//   --output <file.wav>     write the left output channel (32-bit float)
+//   --flash <file>          persist the QSPI settings region in a file
+//   --ir <file.wav>         store a cabinet impulse response in the first
+//                           flash slot before starting
+//   --trace <file.csv>      log LED and control changes
+//   --midi <file.csv>       log the MIDI output with its send times
+//   --repeat <n>            run the timeline n times back to back
+//
+// Timeline lines are "<seconds> <control> <value>", for example:
+//
+//   0.0  knob1   0.5
+//   0.0  toggle2 on
+//   1.0  stomp2  press
+//   1.1  stomp2  release
+//   30   end
+//
+// Controls are knob1..knob6 (0..1), toggle1..toggle4 and stomp1..stomp2
+// (on/off, press/release or 1/0). "end" sets the length of one repetition.
+//
+// With a pluck input, every note-on in the MIDI log also gets its latency
+// from the last pluck, and the run ends with a summary.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <util/PersistentSettings.h>
+
+#include "hal/HostHal.h"
+#include "Wav.h"
+
+int firmware_main();
+
+namespace
+{
+
+// Pins as wired in Terrarium::InitToggles() and Terrarium::InitStomps().
+constexpr std::array<daisy::Pin, 4> toggle_pins{
+    daisy::seed::D10,
+    daisy::seed::D9,
+    daisy::seed::D8,
+    daisy::seed::D7,
+};
+constexpr std::array<daisy::Pin, 2> stomp_pins{
+    daisy::seed::D25,
+    daisy::seed::D26,
+};
+// DAC channel index of each LED, as in Terrarium::InitLeds().
+constexpr std::array<int, 2> led_dacs{1, 0};
+
+struct TimelineEvent
+{
+    double time_s = 0.0;
+    std::string control;
+    float value = 0.0f;
+};
+
+struct Timeline
+{
+    std::vector<TimelineEvent> events;
+    double length_s = 0.0;
+};
+
+float ParseValue(const std::string& text)
+{
+    if (text == "on" || text == "press")
+    {
+        return 1.0f;
+    }
+    if (text == "off" || text == "release")
+    {
+        return 0.0f;
+    }
+    return std::stof(text);
+}
+
+bool LoadTimeline(const std::string& path, Timeline& timeline)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        return false;
+    }
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        const auto comment = line.find('#');
+        if (comment != std::string::npos)
+        {
+            line.erase(comment);
+        }
+
+        std::istringstream fields(line);
+        TimelineEvent event;
+        if (!(fields >> event.time_s >> event.control))
+        {
+            continue;
+        }
+
+        if (event.control == "end")
+        {
+            timeline.length_s = event.time_s;
+            continue;
+        }
+
+        std::string value;
+        fields >> value;
+        event.value = ParseValue(value);
+        timeline.events.push_back(event);
+        timeline.length_s = std::max(timeline.length_s, event.time_s);
+    }
+
+    std::stable_sort(timeline.events.begin(), timeline.events.end(),
+        [](const auto& a, const auto& b) { return a.time_s < b.time_s; });
+    return true;
+}
+
+void ApplyEvent(const TimelineEvent& event)
+{
+    auto& hal = host::hal();
+    const auto index = [&](const char* prefix) {
+        return std::atoi(event.control.c_str() + std::strlen(prefix)) - 1;
+    };
+
+    if (event.control.rfind("knob", 0) == 0)
+    {
+        const int i = index("knob");
+        const float v = std::clamp(event.value, 0.0f, 1.0f);
+        hal.adc[i] = static_cast<uint16_t>(std::lround(v * 65535.0f));
+    }
+    else if (event.control.rfind("toggle", 0) == 0)
+    {
+        hal.SetPin(toggle_pins[index("toggle")], event.value > 0.5f);
+    }
+    else if (event.control.rfind("stomp", 0) == 0)
+    {
+        hal.SetPin(stomp_pins[index("stomp")], event.value > 0.5f);
+    }
+    else
+    {
+        fprintf(stderr, "Unknown control '%s'\n", event.control.c_str());
+    }
+}
+
+// Karplus-Strong string, re-plucked at a fixed interval.
+class PluckSource
+{
+public:
+    PluckSource(float frequency, float interval_s, float sample_rate) :
+        _line(static_cast<size_t>(std::max(2.0f, sample_rate / frequency))),
+        _interval(static_cast<uint64_t>(interval_s * sample_rate))
+    {
+    }
+
+    float operator()()
+    {
+        if (_interval > 0 && (_count % _interval) == 0)
+        {
+            std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+            for (auto& s : _line)
+            {
+                s = noise(_random);
+            }
+        }
+        ++_count;
+
+        const size_t next = (_index + 1) % _line.size();
+        const float out = _line[_index];
+        _line[_index] = 0.498f * (_line[_index] + _line[next]);
+        _index = next;
+        return out;
+    }
+
+private:
+    std::vector<float> _line;
+    uint64_t _interval;
+    uint64_t _count = 0;
+    size_t _index = 0;
+    std::minstd_rand _random{1};
+};
+
+// Generated inputs read the sample rate lazily, since the firmware only sets
+// it once it is running.
+std::function<float()> MakeInput(const std::string& spec, std::vector<float>& storage)
+{
+    if (spec.empty() || spec == "silence")
+    {
+        return [] { return 0.0f; };
+    }
+
+    if (spec.rfind("sine:", 0) == 0)
+    {
+        const float frequency = std::stof(spec.substr(5));
+        auto phase = std::make_shared<double>(0.0);
+        return [=] {
+            const float s = 0.3f * static_cast<float>(std::sin(2.0 * M_PI * *phase));
+            *phase = std::fmod(*phase + (frequency / host::hal().SampleRate()), 1.0);
+            return s;
+        };
+    }
+
+    if (spec.rfind("pluck:", 0) == 0)
+    {
+        float frequency = 110.0f;
+        float interval = 2.0f;
+        sscanf(spec.c_str(), "pluck:%f:%f", &frequency, &interval);
+        auto pluck = std::make_shared<std::unique_ptr<PluckSource>>();
+        return [=] {
+            if (!*pluck)
+            {
+                *pluck = std::make_unique<PluckSource>(
+                    frequency, interval, host::hal().SampleRate());
+            }
+            return (**pluck)();
+        };
+    }
+
+    if (!ReadWav(spec, storage))
+    {
+        fprintf(stderr, "Could not read input '%s'\n", spec.c_str());
+        std::exit(1);
+    }
+    auto position = std::make_shared<size_t>(0);
+    return [&storage, position] {
+        return (*position < storage.size()) ? storage[(*position)++] : 0.0f;
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string input_spec;
+    std::string output_path;
+    std::string flash_path;
+    std::string ir_path;
+    std::string trace_path;
+    std::string midi_path;
+    std::string timeline_path;
+    int repeat = 1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto next = [&]() -> std::string {
+            return (i + 1 < argc) ? argv[++i] : "";
+        };
+
+        if (arg == "--input") input_spec = next();
+        else if (arg == "--output") output_path = next();
+        else if (arg == "--flash") flash_path = next();
+        else if (arg == "--ir") ir_path = next();
+        else if (arg == "--trace") trace_path = next();
+        else if (arg == "--midi") midi_path = next();
+        else if (arg == "--repeat") repeat = std::max(1, std::atoi(next().c_str()));
+        else timeline_path = arg;
+    }
+
+    Timeline timeline;
+    if (timeline_path.empty() || !LoadTimeline(timeline_path, timeline))
+    {
+        fprintf(stderr, "usage: %s [options] <timeline>\n", argv[0]);
+        return 1;
+    }
+
+    auto& hal = host::hal();
+    hal.LoadFlash(flash_path);
+
+    if (!ir_path.empty())
+    {
+        std::vector<float> taps;
+        uint32_t ir_rate = 0;
+        if (!ReadWav(ir_path, taps, &ir_rate) || taps.empty())
+        {
+            fprintf(stderr, "Could not read '%s'\n", ir_path.c_str());
+            return 1;
+        }
+        if (taps.size() > impulse_response_max_taps)
+        {
+            fprintf(stderr, "'%s': keeping the first %zu of %zu taps\n",
+                ir_path.c_str(), impulse_response_max_taps, taps.size());
+            taps.resize(impulse_response_max_taps);
+        }
+        daisy::QSPIHandle qspi;
+        storeImpulseResponse(qspi, 0, taps.data(), taps.size(), static_cast<float>(ir_rate));
+    }
+
+    std::vector<float> input_storage;
+    auto input = MakeInput(input_spec, input_storage);
+
+    // Input sample n is consumed at input_start + n.
+    uint64_t input_start = 0;
+    uint64_t input_samples = 0;
+    hal.input = [&]() {
+        if (input_samples++ == 0)
+        {
+            input_start = hal.Now();
+        }
+        return input();
+    };
+
+    float pluck_interval_s = 0.0f;
+    if (input_spec.rfind("pluck:", 0) == 0)
+    {
+        float frequency = 0.0f;
+        pluck_interval_s = 2.0f;
+        sscanf(input_spec.c_str(), "pluck:%f:%f", &frequency, &pluck_interval_s);
+    }
+
+    FILE* midi = midi_path.empty() ? nullptr : fopen(midi_path.c_str(), "w");
+    if (midi)
+    {
+        fprintf(midi, "time_s,status,data1,data2,latency_ms\n");
+    }
+    size_t note_ons = 0;
+    double latency_sum_ms = 0.0;
+    double latency_max_ms = 0.0;
+    hal.midi_output = [&](const uint8_t* bytes, size_t size) {
+        const double rate = hal.SampleRate();
+        const bool note_on = (size == 3) && ((bytes[0] & 0xF0) == 0x90) && (bytes[2] != 0);
+
+        double latency_ms = -1.0;
+        const auto interval = static_cast<uint64_t>(pluck_interval_s * rate);
+        if (note_on && interval > 0 && input_samples > 0)
+        {
+            const uint64_t since_start = hal.Now() - input_start;
+            latency_ms = 1000.0 * static_cast<double>(since_start % interval) / rate;
+            ++note_ons;
+            latency_sum_ms += latency_ms;
+            latency_max_ms = std::max(latency_max_ms, latency_ms);
+        }
+
+        if (midi)
+        {
+            fprintf(midi, "%.6f,0x%02X,%d,%d,", hal.Now() / rate, bytes[0],
+                (size > 1) ? bytes[1] : 0, (size > 2) ? bytes[2] : 0);
+            if (latency_ms >= 0.0)
+            {
+                fprintf(midi, "%.3f", latency_ms);
+            }
+            fprintf(midi, "\n");
+        }
+    };
+
+    std::vector<float> output;
+    size_t nan_count = 0;
+    float peak = 0.0f;
+    hal.output = [&](float s) {
+        if (!std::isfinite(s))
+        {
+            ++nan_count;
+        }
+        peak = std::max(peak, std::abs(s));
+        if (!output_path.empty())
+        {
+            output.push_back(s);
+        }
+    };
+
+    FILE* trace = trace_path.empty() ? nullptr : fopen(trace_path.c_str(), "w");
+    if (trace)
+    {
+        fprintf(trace, "time_s,event,value\n");
+    }
+
+    size_t next_event = 0;
+    uint64_t cycle_start = 0;
+    int cycle = 0;
+    std::array<float, led_dacs.size()> last_led{-1.0f, -1.0f};
+
+    hal.before_block = [&](uint64_t now) {
+        const double rate = hal.SampleRate();
+        const auto cycle_samples = static_cast<uint64_t>(timeline.length_s * rate);
+        hal.end_sample = cycle_samples * static_cast<uint64_t>(repeat);
+
+        while (cycle < repeat)
+        {
+            if (next_event < timeline.events.size())
+            {
+                const auto& event = timeline.events[next_event];
+                const auto at = cycle_start + static_cast<uint64_t>(event.time_s * rate);
+                if (at > now)
+                {
+                    break;
+                }
+                ApplyEvent(event);
+                if (trace)
+                {
+                    fprintf(trace, "%.6f,%s,%g\n", now / rate, event.control.c_str(), event.value);
+                }
+                ++next_event;
+            }
+            else if (now >= cycle_start + cycle_samples)
+            {
+                ++cycle;
+                cycle_start += cycle_samples;
+                next_event = 0;
+            }
+            else
+            {
+                break;
+            }
+        }
+
+        for (size_t i = 0; trace && i < led_dacs.size(); ++i)
+        {
+            const float value = hal.dac[led_dacs[i]];
+            if (value != last_led[i])
+            {
+                last_led[i] = value;
+                fprintf(trace, "%.6f,led%zu,%g\n", now / rate, i + 1, value);
+            }
+        }
+    };
+
+    // Controls set at time 0 are already down at power-on, so boot gestures
+    // can be scripted.
+    hal.before_block(0);
+
+    const auto wall_start = std::chrono::steady_clock::now();
+    try
+    {
+        firmware_main();
+    }
+    catch (const host::SimulationComplete&)
+    {
+    }
+    const std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start;
+
+    if (trace)
+    {
+        fclose(trace);
+    }
+    if (midi)
+    {
+        fclose(midi);
+    }
+    if (!output_path.empty())
+    {
+        WriteWav(output_path, output, static_cast<uint32_t>(hal.SampleRate()));
+    }
+
+    const double simulated = hal.Now() / static_cast<double>(hal.SampleRate());
+    printf("Simulated %.1f s in %.2f s (%.0fx real time)\n",
+        simulated, wall.count(), simulated / std::max(wall.count(), 1e-9));
+    printf("Output peak %.3f, non-finite samples %zu\n", peak, nan_count);
+    if (note_ons > 0)
+    {
+        printf("MIDI: %zu note-ons, pluck to note-on %.2f ms mean, %.2f ms max\n",
+            note_ons, latency_sum_ms / static_cast<double>(note_ons), latency_max_ms);
+    }
+    return (nan_count == 0) ? 0 : 2;
+}
@@ -0,0 +1,567 @@
+// Spectral quality of the oscillators and saturation stages, next to their
+// cost.
+//
+//   terrarium_spectrum [options]
+//
+//   --filter <text>     only run variants whose name contains text
+//   --rate <hz>         sample rate (default 48000)
+//   --size <n>          FFT size, a power of two (default 32768)
+//   --repeat <n>        timed renders per point (default 5)
+//   --json <file>       also write every point as JSON
+//
+// Every variant is swept in octaves from 55 Hz up to the highest pitch the
+// main oscillator can play, PLL::max_frequency_hz. Each test frequency is
+// moved to an odd FFT bin so the render is periodic in the FFT frame. With a
+// Hann window, every component then lands on exactly three bins, and the
+// spectrum can be split without guesswork:
+//
+//   harmonics  multiples of the fundamental below Nyquist
+//   aliasing   multiples above Nyquist, folded back
+//   noise      everything else except DC
+//
+// Harmonics are followed through four folds, so aliasing from further up
+// counts as noise. Low tones leave few bins that belong to no component;
+// their noise is not reported (nan, null in JSON).
+// THD is harmonic energy over the fundamental. Aliasing and noise are given
+// relative to the wanted signal, fundamental plus harmonics. For an
+// oscillator, harmonics are the waveform and aliasing is the number to watch.
+// The summary lists the worst case of each variant over the sweep, so the
+// cheapest variant that is still clean enough can be picked.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <numbers>
+#include <string>
+#include <vector>
+
+#include <util/Harmonizer.h>
+#include <util/PLL.h>
+#include <util/WaveSynth.h>
+
+namespace
+{
+
+// Results are folded into this so renders can't be discarded.
+volatile float sink = 0.0f;
+
+struct Variant
+{
+    std::string name;
+    std::string setting;
+    // Fills output with a tone at exactly bin / output.size() of the sample
+    // rate. Oscillators synthesize it, saturation stages process input, a
+    // full-scale sine on that bin.
+    std::function<void(size_t bin, float sample_rate, const std::vector<float>& input,
+        std::vector<float>& output)> render;
+};
+
+struct Point
+{
+    std::string name;
+    std::string setting;
+    float frequency = 0.0f;
+    double thd_db = 0.0;
+    double alias_db = 0.0;
+    double noise_db = 0.0;
+    double ns_per_sample = 0.0;
+};
+
+double Decibels(double ratio)
+{
+    return 10.0 * std::log10(std::max(ratio, 1e-20));
+}
+
+// In-place iterative radix-2 FFT.
+void Fft(std::vector<std::complex<double>>& data)
+{
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; ++i)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        const double angle = -2.0 * std::numbers::pi / static_cast<double>(length);
+        const std::complex<double> step{std::cos(angle), std::sin(angle)};
+        for (size_t start = 0; start < n; start += length)
+        {
+            std::complex<double> twiddle{1.0, 0.0};
+            for (size_t k = 0; k < length / 2; ++k)
+            {
+                const auto even = data[start + k];
+                const auto odd = data[start + k + (length / 2)] * twiddle;
+                data[start + k] = even + odd;
+                data[start + k + (length / 2)] = even - odd;
+                twiddle *= step;
+            }
+        }
+    }
+}
+
+struct Quality
+{
+    double thd_db;
+    double alias_db;
+    double noise_db;
+};
+
+Quality Analyze(const std::vector<float>& signal, size_t fundamental_bin)
+{
+    const size_t n = signal.size();
+    std::vector<std::complex<double>> spectrum(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double window = 0.5 - (0.5 * std::cos(2.0 * std::numbers::pi * i / n));
+        spectrum[i] = signal[i] * window;
+    }
+    Fft(spectrum);
+
+    enum class Kind : uint8_t { Noise, Dc, Fundamental, Harmonic, Alias };
+    const size_t half = n / 2;
+    std::vector<Kind> kinds(half + 1, Kind::Noise);
+
+    // Aliases only take bins no other component has claimed.
+    const auto mark = [&](size_t bin, Kind kind) {
+        for (size_t b = (bin > 0 ? bin - 1 : 0); b <= std::min(bin + 1, half); ++b)
+        {
+            if (kinds[b] == Kind::Noise || kinds[b] == Kind::Alias)
+            {
+                kinds[b] = kind;
+            }
+        }
+    };
+
+    // Harmonics are followed through a few folds; beyond that they are far
+    // down and would claim most of the bins of a low tone.
+    constexpr size_t folds = 4;
+    for (size_t h = 2; h * fundamental_bin <= folds * n; ++h)
+    {
+        const size_t wrapped = (h * fundamental_bin) % n;
+        const size_t folded = (wrapped > half) ? n - wrapped : wrapped;
+        if (h * fundamental_bin <= half)
+        {
+            mark(folded, Kind::Harmonic);
+        }
+        else
+        {
+            mark(folded, Kind::Alias);
+        }
+    }
+    mark(fundamental_bin, Kind::Fundamental);
+    mark(0, Kind::Dc);
+
+    double fundamental = 0.0;
+    double harmonics = 0.0;
+    double aliasing = 0.0;
+    double noise = 0.0;
+    size_t noise_bins = 0;
+    for (size_t b = 0; b <= half; ++b)
+    {
+        const double power = std::norm(spectrum[b]);
+        switch (kinds[b])
+        {
+            case Kind::Fundamental: fundamental += power; break;
+            case Kind::Harmonic: harmonics += power; break;
+            case Kind::Alias: aliasing += power; break;
+            case Kind::Noise: noise += power; ++noise_bins; break;
+            case Kind::Dc: break;
+        }
+    }
+
+    // Too few free bins to say anything about the noise.
+    const bool noise_valid = noise_bins >= half / 16;
+
+    const double wanted = std::max(fundamental + harmonics, 1e-30);
+    return {
+        Decibels(harmonics / std::max(fundamental, 1e-30)),
+        Decibels(aliasing / wanted),
+        noise_valid ? Decibels(noise / wanted) : std::nan(""),
+    };
+}
+
+// 2x oversampling with a windowed-sinc half-band low-pass for the way up and
+// the way down. The filters are plain FIRs that skip the zero taps, without
+// a polyphase split, so the cost is an upper bound.
+class Oversampler
+{
+public:
+    Oversampler()
+    {
+        const int center = taps / 2;
+        float sum = 0.0f;
+        for (int i = 0; i < taps; ++i)
+        {
+            const double x = (i - center) / 2.0;
+            const double sinc = (i == center) ? 1.0 : std::sin(std::numbers::pi * x) / (std::numbers::pi * x);
+            const double phase = 2.0 * std::numbers::pi * i / (taps - 1);
+            const double blackman = 0.42 - (0.5 * std::cos(phase)) + (0.08 * std::cos(2.0 * phase));
+            _kernel[i] = static_cast<float>(sinc * blackman);
+            sum += _kernel[i];
+        }
+        for (auto& k : _kernel)
+        {
+            k /= sum;
+        }
+    }
+
+    // Two samples at twice the rate from one.
+    std::array<float, 2> Up(float x)
+    {
+        return {Filter(_up, 2.0f * x), Filter(_up, 0.0f)};
+    }
+
+    // One sample from two at twice the rate.
+    float Down(float a, float b)
+    {
+        Filter(_down, a);
+        return Filter(_down, b);
+    }
+
+private:
+    static constexpr int taps = 63;
+
+    // Every sample is stored twice, so the newest taps are always one
+    // contiguous run.
+    struct Line
+    {
+        std::array<float, 2 * taps> history{};
+        int position = 0;
+    };
+
+    float Filter(Line& line, float x)
+    {
+        line.position = (line.position == 0) ? taps - 1 : line.position - 1;
+        line.history[line.position] = x;
+        line.history[line.position + taps] = x;
+
+        const float* newest = &line.history[line.position];
+        float sum = _kernel[taps / 2] * newest[taps / 2];
+        for (int i = ((taps / 2) + 1) % 2; i < taps; i += 2)
+        {
+            sum += _kernel[i] * newest[i];
+        }
+        return sum;
+    }
+
+    std::array<float, taps> _kernel{};
+    Line _up;
+    Line _down;
+};
+
+// Phase increment for a tone on an exact FFT bin.
+uint32_t BinPhaseStep(size_t bin, size_t size)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(bin) << 32) / size);
+}
+
+// A full-scale sine on an exact FFT bin.
+void BinSine(size_t bin, std::vector<float>& output)
+{
+    const size_t size = output.size();
+    for (size_t i = 0; i < size; ++i)
+    {
+        const size_t position = (bin * i) % size;
+        output[i] = static_cast<float>(std::sin(2.0 * std::numbers::pi * position / size));
+    }
+}
+
+std::string Setting(const char* label, float value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%s %.4g", label, value);
+    return text;
+}
+
+std::vector<Variant> MakeVariants()
+{
+    std::vector<Variant> variants;
+
+    for (const float shape : {0.0f, 1.0f, 2.0f, 3.0f})
+    {
+        const auto setting = Setting("shape", shape);
+
+        variants.push_back({"WaveSynth::compensated", setting,
+            [shape](size_t bin, float, const auto&, std::vector<float>& output) {
+                const WaveSynth synth{shape};
+                const uint32_t step = BinPhaseStep(bin, output.size());
+                uint32_t phase = 0;
+                for (auto& y : output)
+                {
+                    y = synth.compensated(q::phase{phase});
+                    phase += step;
+                }
+            }});
+
+        variants.push_back({"WaveSynth 2x oversampled", setting,
+            [shape](size_t bin, float, const auto&, std::vector<float>& output) {
+                const WaveSynth synth{shape};
+                Oversampler oversampler;
+                const uint32_t step = BinPhaseStep(bin, 2 * output.size());
+                uint32_t phase = 0;
+                // Run the filter in over one period first, so the frame
+                // holds the steady state.
+                for (size_t pass = 0; pass < 2; ++pass)
+                {
+                    for (auto& y : output)
+                    {
+                        const float a = synth.compensated(q::phase{phase});
+                        const float b = synth.compensated(q::phase{phase + step});
+                        y = oversampler.Down(a, b);
+                        phase += 2 * step;
+                    }
+                }
+            }});
+
+        variants.push_back({"Harmonizer table", setting,
+            [shape](size_t bin, float sample_rate, const auto&, std::vector<float>& output) {
+                Harmonizer harmonizer;
+                harmonizer.Init(sample_rate);
+                harmonizer.SetRatio(0, 1.0f);
+                harmonizer.SetShape(0, shape);
+                harmonizer.SetFrequency(bin * sample_rate / output.size());
+                for (auto& y : output)
+                {
+                    y = harmonizer(0);
+                    harmonizer.Advance();
+                }
+            }});
+
+        variants.push_back({"RenderShapedPhase", setting,
+            [shape](size_t bin, float, const auto&, std::vector<float>& output) {
+                const float step = static_cast<float>(bin) / output.size();
+                float phase = 0.0f;
+                for (auto& y : output)
+                {
+                    y = Harmonizer::RenderShapedPhase(phase, shape);
+                    phase += step;
+                    phase -= (phase >= 1.0f) ? 1.0f : 0.0f;
+                }
+            }});
+    }
+
+    for (const float drive : {PLL::voice_bus_drive, PLL::osc_body_drive, PLL::osc_wah_drive})
+    {
+        const auto setting = Setting("drive", drive);
+
+        variants.push_back({"std::tanh", setting,
+            [drive](size_t, float, const auto& input, std::vector<float>& output) {
+                for (size_t i = 0; i < output.size(); ++i)
+                {
+                    output[i] = std::tanh(input[i] * drive);
+                }
+            }});
+
+        // The usual [3/2] Pade approximation, exact at +-3 and clamped there.
+        variants.push_back({"rational tanh", setting,
+            [drive](size_t, float, const auto& input, std::vector<float>& output) {
+                for (size_t i = 0; i < output.size(); ++i)
+                {
+                    const float x = std::clamp(input[i] * drive, -3.0f, 3.0f);
+                    output[i] = x * (27.0f + (x * x)) / (27.0f + (9.0f * x * x));
+                }
+            }});
+
+        variants.push_back({"std::tanh 2x oversampled", setting,
+            [drive](size_t, float, const auto& input, std::vector<float>& output) {
+                Oversampler oversampler;
+                for (size_t pass = 0; pass < 2; ++pass)
+                {
+                    for (size_t i = 0; i < output.size(); ++i)
+                    {
+                        const auto up = oversampler.Up(input[i]);
+                        output[i] = oversampler.Down(std::tanh(up[0] * drive), std::tanh(up[1] * drive));
+                    }
+                }
+            }});
+    }
+
+    // Thresholds across the range Process() maps the trigger knob to, after
+    // its halving.
+    for (const float threshold : {0.0004f, 0.004f, 0.04f})
+    {
+        variants.push_back({"Fuzz::Process", Setting("threshold", threshold),
+            [threshold](size_t, float, const auto& input, std::vector<float>& output) {
+                Fuzz fuzz;
+                for (size_t i = 0; i < output.size(); ++i)
+                {
+                    // A moderate pick level, as the fuzz stage sees it.
+                    const float dry = 0.25f * input[i];
+                    const float input = std::clamp(dry * PLL::fuzz_drive, -1.0f, 1.0f);
+                    output[i] = std::clamp(fuzz.Process(input, threshold) * PLL::fuzz_makeup_gain, -1.0f, 1.0f);
+                }
+            }});
+    }
+
+    return variants;
+}
+
+// Octaves from 55 Hz, plus the top of the range.
+std::vector<float> SweepFrequencies()
+{
+    constexpr float top = PLL::max_frequency_hz;
+    std::vector<float> frequencies;
+    for (float f = 55.0f; f < top; f *= 2.0f)
+    {
+        frequencies.push_back(f);
+    }
+    frequencies.push_back(top);
+    return frequencies;
+}
+
+// Nearest odd bin, so harmonics and their aliases don't pile onto each other.
+size_t OddBin(float frequency, float sample_rate, size_t size)
+{
+    const auto bin = static_cast<size_t>(std::lround(frequency * size / sample_rate));
+    return std::clamp<size_t>(bin | 1, 1, (size / 2) - 1);
+}
+
+double TimeRender(const Variant& variant, size_t bin, float sample_rate,
+    const std::vector<float>& input, std::vector<float>& output, int repeat)
+{
+    std::vector<double> runs;
+    for (int i = 0; i < repeat; ++i)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        variant.render(bin, sample_rate, input, output);
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        sink = sink + output[bin % output.size()];
+        runs.push_back(elapsed.count() / static_cast<double>(output.size()));
+    }
+    std::sort(runs.begin(), runs.end());
+    return runs[runs.size() / 2];
+}
+
+void WriteJson(const std::string& path, const std::vector<Point>& points, float sample_rate, size_t size)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write '%s'\n", path.c_str());
+        return;
+    }
+
+    fprintf(file, "{\n  \"sample_rate\": %.0f,\n  \"fft_size\": %zu,\n  \"points\": [\n", sample_rate, size);
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const auto& point = points[i];
+        char noise[16] = "null";
+        if (!std::isnan(point.noise_db))
+        {
+            snprintf(noise, sizeof(noise), "%.2f", point.noise_db);
+        }
+        fprintf(file,
+            "    {\"name\": \"%s\", \"setting\": \"%s\", \"frequency\": %.2f, \"thd_db\": %.2f, "
+            "\"alias_db\": %.2f, \"noise_db\": %s, \"ns_per_sample\": %.3f}%s\n",
+            point.name.c_str(), point.setting.c_str(), point.frequency, point.thd_db,
+            point.alias_db, noise, point.ns_per_sample,
+            (i + 1 < points.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    std::string json_path;
+    float sample_rate = 48000.0f;
+    size_t size = 32768;
+    int repeat = 5;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto next = [&]() -> std::string {
+            return (i + 1 < argc) ? argv[++i] : "";
+        };
+
+        if (arg == "--filter") filter = next();
+        else if (arg == "--rate") sample_rate = std::max(8000.0f, std::strtof(next().c_str(), nullptr));
+        else if (arg == "--size") size = std::strtoul(next().c_str(), nullptr, 10);
+        else if (arg == "--repeat") repeat = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--json") json_path = next();
+        else
+        {
+            fprintf(stderr, "usage: %s [--filter text] [--rate hz] [--size n] [--repeat n] "
+                "[--json file]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (size < 1024 || (size & (size - 1)) != 0)
+    {
+        fprintf(stderr, "--size must be a power of two of at least 1024\n");
+        return 1;
+    }
+
+
+    printf("%-26s %-15s %9s %8s %8s %8s  per sample\n",
+        "variant", "setting", "Hz", "THD dB", "alias dB", "noise dB");
+
+    std::vector<Point> points;
+    std::vector<Point> worst;
+    std::vector<float> input(size);
+    std::vector<float> output(size);
+    for (const auto& variant : MakeVariants())
+    {
+        if (!filter.empty() && variant.name.find(filter) == std::string::npos)
+        {
+            continue;
+        }
+
+        Point summary{variant.name, variant.setting, 0.0f, -200.0, -200.0, std::nan(""), 0.0};
+        const auto frequencies = SweepFrequencies();
+        for (const float requested : frequencies)
+        {
+            const size_t bin = OddBin(requested, sample_rate, size);
+            const float frequency = bin * sample_rate / size;
+            BinSine(bin, input);
+            const double ns = TimeRender(variant, bin, sample_rate, input, output, repeat);
+            const auto quality = Analyze(output, bin);
+
+            points.push_back({variant.name, variant.setting, frequency,
+                quality.thd_db, quality.alias_db, quality.noise_db, ns});
+            printf("%-26s %-15s %9.1f %8.1f %8.1f %8.1f  %8.2f ns\n",
+                variant.name.c_str(), variant.setting.c_str(), frequency,
+                quality.thd_db, quality.alias_db, quality.noise_db, ns);
+
+            summary.thd_db = std::max(summary.thd_db, quality.thd_db);
+            summary.alias_db = std::max(summary.alias_db, quality.alias_db);
+            summary.noise_db = std::fmax(summary.noise_db, quality.noise_db);
+            summary.ns_per_sample += ns / static_cast<double>(frequencies.size());
+        }
+        worst.push_back(summary);
+    }
+
+    printf("\nWorst case over the sweep, mean cost:\n");
+    for (const auto& summary : worst)
+    {
+        printf("%-26s %-15s %9s %8.1f %8.1f %8.1f  %8.2f ns\n",
+            summary.name.c_str(), summary.setting.c_str(), "",
+            summary.thd_db, summary.alias_db, summary.noise_db, summary.ns_per_sample);
+    }
+
+    if (!json_path.empty())
+    {
+        WriteJson(json_path, points, sample_rate, size);
+    }
+    return 0;
+}
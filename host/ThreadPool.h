@@ -0,0 +1,159 @@
+#pragma once
+
+// Work-stealing thread pool for the host tools.
+//
+// ForEach() deals the indices out round-robin onto one deque per worker.
+// Each worker takes from the back of its own deque and, once that is empty,
+// steals from the front of the others, so uneven tasks still keep every
+// core busy until the last one finishes.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t threads = 0)
+    {
+        const size_t count = (threads > 0)
+            ? threads
+            : std::max<size_t>(1, std::thread::hardware_concurrency());
+        for (size_t i = 0; i < count; ++i)
+        {
+            _queues.push_back(std::make_unique<Queue>());
+        }
+        for (size_t i = 0; i < count; ++i)
+        {
+            _threads.emplace_back([this, i] { Run(i); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+        _wake.notify_all();
+        for (auto& thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t Size() const { return _threads.size(); }
+
+    // Runs task(i) for every i in [0, count) and returns when all are done.
+    // Tasks must not call ForEach() themselves.
+    void ForEach(size_t count, const std::function<void(size_t)>& task)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+
+        // A worker still draining the previous call may pick these up, so
+        // the task is in place before any index is queued.
+        std::unique_lock<std::mutex> lock(_mutex);
+        _task = &task;
+        _remaining = count;
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto& queue = *_queues[i % _queues.size()];
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            queue.tasks.push_back(i);
+        }
+        ++_generation;
+        _wake.notify_all();
+        _done.wait(lock, [this] { return _remaining == 0; });
+        _task = nullptr;
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    bool Pop(size_t worker, size_t& index)
+    {
+        {
+            auto& own = *_queues[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty())
+            {
+                index = own.tasks.back();
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < _queues.size(); ++offset)
+        {
+            auto& victim = *_queues[(worker + offset) % _queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                index = victim.tasks.front();
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Run(size_t worker)
+    {
+        size_t seen_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [&] { return _stopping || _generation != seen_generation; });
+                if (_stopping)
+                {
+                    return;
+                }
+                seen_generation = _generation;
+            }
+
+            size_t index;
+            while (Pop(worker, index))
+            {
+                const std::function<void(size_t)>* task = nullptr;
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    task = _task;
+                }
+                (*task)(index);
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_remaining == 0)
+                {
+                    _done.notify_one();
+                }
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+    const std::function<void(size_t)>* _task = nullptr;
+    size_t _remaining = 0;
+    size_t _generation = 0;
+    bool _stopping = false;
+};
@@ -0,0 +1,781 @@
+// Explores the PLL tuning space on a synthetic test corpus.
+//
+//   terrarium_tune [options]
+//
+//   --grid <n>          evaluate n values per dimension, spaced evenly (log
+//                       spaced for gains and times)
+//   --optimize <n>      up to n iterations of compass search, from the best
+//                       grid point or from the current tuning
+//   --dims <a,b,...>    dimensions to explore (default all); the rest keep
+//                       their current value
+//   --weights <l,c,o>   score weights for lock time, cents error and octave
+//                       errors (default 1,1,1)
+//   --threads <n>       worker threads (default every core)
+//   --top <n>           ranked candidates to print (default 10)
+//   --json <file>       also write every evaluated point as JSON
+//   --quadrature        explore with the quadrature phase detector
+//   --compare-detectors only run the current tuning, once with each phase
+//                       detector
+//
+// Every point renders the whole corpus through a fresh PLL in Track() mode
+// and is scored on three things, each averaged over the notes:
+//
+//   lock ms    from the note's onset until the tracked pitch stays within
+//              lock_cents for lock_hold_s; a note that never gets there
+//              counts its whole length
+//   cents      mean absolute error of the tracked pitch after lock, octave
+//              errors excluded and each sample clipped at 100 cents
+//   octave %   share of the time after lock spent a whole number of octaves
+//              away from the note
+//
+// The score ranks points on a weighted sum, with each metric divided by a
+// reference value that counts as good: 20 ms, 5 cents and 1 %. The Pareto
+// front lists the points that no other point beats on all three at once.
+//
+// Jitter, the RMS wander of the tracked pitch around each note's own mean
+// after lock, is listed alongside but not scored: vibrato and slow drift
+// count towards it, so it only compares points on the same corpus.
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <numbers>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <util/Controls.h>
+#include <util/PLL.h>
+
+#include "ThreadPool.h"
+
+namespace
+{
+
+constexpr float sample_rate = 48000.0f;
+constexpr float lock_cents = 25.0f;
+constexpr float lock_hold_s = 0.02f;
+constexpr float octave_band_cents = 100.0f;
+constexpr float cents_clip = 100.0f;
+
+constexpr double lock_reference_ms = 20.0;
+constexpr double cents_reference = 5.0;
+constexpr double octave_reference_percent = 1.0;
+
+// Set once from the command line, before any evaluation starts.
+bool quadrature_detector = false;
+
+struct Dimension
+{
+    const char* name;
+    const char* field;
+    float PLL::Params::*value;
+    float min;
+    float max;
+    bool log;
+};
+
+// Ranges are the ones PLL::SetParams() clamps to, narrowed where the ends
+// are known not to track at all.
+const std::array<Dimension, 6> dimensions{{
+    {"kp_hz", "pll_kp_hz", &PLL::Params::pll_kp_hz, 40.0f, 800.0f, true},
+    {"ki_hz", "pll_ki_hz", &PLL::Params::pll_ki_hz, 0.02f, 3.0f, true},
+    {"alpha", "pll_error_filter_alpha", &PLL::Params::pll_error_filter_alpha, 0.0005f, 0.05f, true},
+    {"follow_s", "glide_follow_s", &PLL::Params::glide_follow_s, 0.0005f, 0.02f, true},
+    {"fll_gain", "fll_gain", &PLL::Params::fll_gain, 0.0f, 1.0f, false},
+    {"limit_hz", "pll_integrator_limit_hz", &PLL::Params::pll_integrator_limit_hz, 50.0f, 800.0f, true},
+}};
+
+struct NoteSpan
+{
+    size_t begin;
+    size_t end;
+    float frequency_hz;
+};
+
+struct Clip
+{
+    std::string name;
+    std::vector<float> audio;
+    std::vector<NoteSpan> notes;
+};
+
+struct Metrics
+{
+    double lock_ms = 0.0;
+    double cents = 0.0;
+    double octave_percent = 0.0;
+    double jitter_cents = 0.0;
+    int missed = 0;
+};
+
+// Per-clip sums, added up across the corpus before averaging.
+struct Totals
+{
+    double lock_ms = 0.0;
+    double cents_sum = 0.0;
+    double cents_samples = 0.0;
+    double octave_samples = 0.0;
+    double tracked_samples = 0.0;
+    double jitter_squares = 0.0;
+    int notes = 0;
+    int missed = 0;
+
+    void Add(const Totals& other)
+    {
+        lock_ms += other.lock_ms;
+        cents_sum += other.cents_sum;
+        cents_samples += other.cents_samples;
+        octave_samples += other.octave_samples;
+        tracked_samples += other.tracked_samples;
+        jitter_squares += other.jitter_squares;
+        notes += other.notes;
+        missed += other.missed;
+    }
+
+    Metrics Average() const
+    {
+        Metrics metrics;
+        metrics.lock_ms = lock_ms / std::max(notes, 1);
+        metrics.cents = cents_sum / std::max(cents_samples, 1.0);
+        metrics.octave_percent = 100.0 * octave_samples / std::max(tracked_samples, 1.0);
+        metrics.jitter_cents = std::sqrt(jitter_squares / std::max(cents_samples, 1.0));
+        metrics.missed = missed;
+        return metrics;
+    }
+};
+
+struct Point
+{
+    // Normalized 0..1 per dimension.
+    std::vector<float> position;
+    Metrics metrics;
+    double score = 0.0;
+    bool pareto = false;
+};
+
+// A picked string: harmonics falling off as 1/k^2 with slight
+// inharmonicity, the upper ones decaying faster, and a short noise burst for
+// the pick.
+void AddPluck(std::vector<float>& audio, size_t begin, size_t end, float frequency_hz,
+    float level, float second_harmonic, float vibrato_cents, std::minstd_rand& random)
+{
+    constexpr auto pi = std::numbers::pi_v<float>;
+    constexpr int harmonics = 12;
+    constexpr float inharmonicity = 0.0001f;
+
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::array<float, harmonics> phases{};
+    for (auto& phase : phases)
+    {
+        phase = unit(random);
+    }
+
+    const float attack_samples = 0.002f * sample_rate;
+    const float burst_samples = 0.01f * sample_rate;
+    std::array<float, harmonics> increments{};
+    std::array<float, harmonics> amplitudes{};
+    for (int k = 1; k <= harmonics; ++k)
+    {
+        const float stretch = std::sqrt(1.0f + (inharmonicity * static_cast<float>(k * k)));
+        increments[k - 1] = static_cast<float>(k) * frequency_hz * stretch / sample_rate;
+        amplitudes[k - 1] = (k == 2 ? second_harmonic : 1.0f) / static_cast<float>(k * k);
+    }
+
+    for (size_t i = begin; i < std::min(end, audio.size()); ++i)
+    {
+        const float n = static_cast<float>(i - begin);
+        const float t = n / sample_rate;
+        const float vibrato = std::exp2(vibrato_cents * std::sin(2.0f * pi * 5.0f * t) / 1200.0f);
+
+        float sum = 0.0f;
+        for (int k = 0; k < harmonics; ++k)
+        {
+            const float decay = std::exp(-t * 2.0f * (1.0f + (0.3f * static_cast<float>(k))));
+            sum += amplitudes[k] * decay * std::sin(2.0f * pi * phases[k]);
+            phases[k] += increments[k] * vibrato;
+            phases[k] -= std::floor(phases[k]);
+        }
+
+        const float attack = std::min(n / attack_samples, 1.0f);
+        const float burst = (n < burst_samples) ? (unit(random) - 0.5f) * (1.0f - (n / burst_samples)) : 0.0f;
+        audio[i] += level * ((attack * sum * 0.3f) + (0.2f * burst));
+    }
+}
+
+struct NoteSpec
+{
+    float frequency_hz;
+    float length_s;
+    float gap_s;
+    float second_harmonic = 1.0f;
+    float vibrato_cents = 0.0f;
+};
+
+Clip MakeClip(const std::string& name, const std::vector<NoteSpec>& specs, uint32_t seed)
+{
+    std::minstd_rand random{seed};
+    std::normal_distribution<float> noise(0.0f, 0.0005f);
+
+    Clip clip;
+    clip.name = name;
+    size_t length = static_cast<size_t>(0.1f * sample_rate);
+    for (const auto& spec : specs)
+    {
+        length += static_cast<size_t>((spec.length_s + spec.gap_s) * sample_rate);
+    }
+    clip.audio.resize(length);
+
+    size_t position = static_cast<size_t>(0.1f * sample_rate);
+    for (const auto& spec : specs)
+    {
+        const size_t end = position + static_cast<size_t>(spec.length_s * sample_rate);
+        // Legato notes carry on ringing underneath the next one briefly.
+        const size_t ring = (spec.gap_s > 0.0f) ? end : std::min(length, end + static_cast<size_t>(0.01f * sample_rate));
+        AddPluck(clip.audio, position, ring, spec.frequency_hz, 1.0f, spec.second_harmonic, spec.vibrato_cents, random);
+        clip.notes.push_back({position, end, spec.frequency_hz});
+        position = end + static_cast<size_t>(spec.gap_s * sample_rate);
+    }
+    for (auto& sample : clip.audio)
+    {
+        sample += noise(random);
+    }
+    return clip;
+}
+
+std::vector<Clip> MakeCorpus()
+{
+    std::vector<Clip> corpus;
+    corpus.push_back(MakeClip("staccato", {
+        {82.41f, 0.8f, 0.25f}, {110.0f, 0.8f, 0.25f}, {146.83f, 0.8f, 0.25f},
+        {196.0f, 0.8f, 0.25f}, {246.94f, 0.8f, 0.25f}, {329.63f, 0.8f, 0.25f},
+        {440.0f, 0.8f, 0.25f}, {659.26f, 0.8f, 0.25f},
+    }, 1));
+    corpus.push_back(MakeClip("legato", {
+        {110.0f, 0.35f, 0.0f}, {130.81f, 0.35f, 0.0f}, {146.83f, 0.35f, 0.0f},
+        {164.81f, 0.35f, 0.0f}, {196.0f, 0.35f, 0.0f}, {220.0f, 0.5f, 0.2f},
+        {293.66f, 0.3f, 0.0f}, {261.63f, 0.3f, 0.0f}, {220.0f, 0.5f, 0.2f},
+    }, 2));
+    // A second harmonic louder than the fundamental invites octave errors.
+    corpus.push_back(MakeClip("octave bait", {
+        {82.41f, 0.8f, 0.25f, 2.5f}, {98.0f, 0.8f, 0.25f, 2.5f},
+        {110.0f, 0.8f, 0.25f, 2.5f}, {123.47f, 0.8f, 0.25f, 2.5f},
+    }, 3));
+    corpus.push_back(MakeClip("vibrato", {
+        {196.0f, 1.2f, 0.25f, 1.0f, 30.0f}, {329.63f, 1.2f, 0.25f, 1.0f, 30.0f},
+    }, 4));
+    return corpus;
+}
+
+PLL::Params MakeParams(const std::vector<float>& position)
+{
+    PLL::Params params = DefaultParams();
+    ControlState controls{};
+    controls.knobs = {0.3f, 0.6f, 0.5f, 0.3f, 0.7f, 0.8f};
+    controls.toggles = {true, true, true, false};
+    float output_level = 0.0f;
+    ApplyControlState(controls, params, output_level);
+    params.quadrature_detector = quadrature_detector;
+
+    for (size_t d = 0; d < dimensions.size(); ++d)
+    {
+        const auto& dimension = dimensions[d];
+        const float x = std::clamp(position[d], 0.0f, 1.0f);
+        params.*dimension.value = dimension.log
+            ? dimension.min * std::pow(dimension.max / dimension.min, x)
+            : std::lerp(dimension.min, dimension.max, x);
+    }
+    return params;
+}
+
+// Inverse of the mapping in MakeParams(), for the current tuning.
+std::vector<float> CurrentPosition()
+{
+    PLL::Params params = DefaultParams();
+    ControlState controls{};
+    controls.knobs = {0.3f, 0.6f, 0.5f, 0.3f, 0.7f, 0.8f};
+    controls.toggles = {true, true, true, false};
+    float output_level = 0.0f;
+    ApplyControlState(controls, params, output_level);
+
+    std::vector<float> position(dimensions.size());
+    for (size_t d = 0; d < dimensions.size(); ++d)
+    {
+        const auto& dimension = dimensions[d];
+        const float value = params.*dimension.value;
+        position[d] = dimension.log
+            ? std::log(value / dimension.min) / std::log(dimension.max / dimension.min)
+            : (value - dimension.min) / (dimension.max - dimension.min);
+        position[d] = std::clamp(position[d], 0.0f, 1.0f);
+    }
+    return position;
+}
+
+Totals Evaluate(const PLL::Params& params, const Clip& clip)
+{
+    PLL pll;
+    pll.Init(sample_rate);
+    pll.SetParams(params);
+
+    std::vector<float> tracked(clip.audio.size());
+    for (size_t i = 0; i < clip.audio.size(); i += 2)
+    {
+        pll.BeginBlock(2);
+        for (size_t j = i; j < std::min(i + 2, clip.audio.size()); ++j)
+        {
+            pll.Track(clip.audio[j]);
+            tracked[j] = pll.TrackedFrequency();
+        }
+    }
+
+    const auto hold = static_cast<size_t>(lock_hold_s * sample_rate);
+    Totals totals;
+    for (const auto& note : clip.notes)
+    {
+        ++totals.notes;
+
+        size_t lock = note.end;
+        size_t run = 0;
+        for (size_t i = note.begin; i < note.end; ++i)
+        {
+            const bool close = tracked[i] > 1.0f
+                && std::abs(1200.0f * std::log2(tracked[i] / note.frequency_hz)) < lock_cents;
+            run = close ? run + 1 : 0;
+            if (run >= hold)
+            {
+                lock = i + 1 - run;
+                break;
+            }
+        }
+        totals.lock_ms += 1000.0 * static_cast<double>(lock - note.begin) / sample_rate;
+        if (lock == note.end)
+        {
+            ++totals.missed;
+            continue;
+        }
+
+        // Silence once the gate closes is neither right nor wrong.
+        double note_sum = 0.0;
+        double note_squares = 0.0;
+        double note_samples = 0.0;
+        for (size_t i = lock; i < note.end; ++i)
+        {
+            if (tracked[i] <= 1.0f)
+            {
+                continue;
+            }
+            const float cents = 1200.0f * std::log2(tracked[i] / note.frequency_hz);
+            const float octaves = std::round(cents / 1200.0f);
+            totals.tracked_samples += 1.0;
+            if (octaves != 0.0f && std::abs(cents - (1200.0f * octaves)) < octave_band_cents)
+            {
+                totals.octave_samples += 1.0;
+                continue;
+            }
+            totals.cents_sum += std::min(std::abs(cents), cents_clip);
+            totals.cents_samples += 1.0;
+            const double clipped = std::clamp(cents, -cents_clip, cents_clip);
+            note_sum += clipped;
+            note_squares += clipped * clipped;
+            note_samples += 1.0;
+        }
+        if (note_samples > 0.0)
+        {
+            // Squared deviations from the note's mean.
+            totals.jitter_squares += std::max(0.0, note_squares - (note_sum * note_sum / note_samples));
+        }
+    }
+    return totals;
+}
+
+class Explorer
+{
+public:
+    Explorer(const std::vector<Clip>& corpus, ThreadPool& pool, std::array<double, 3> weights) :
+        _corpus(corpus),
+        _pool(pool),
+        _weights(weights)
+    {
+    }
+
+    // Evaluates every position in parallel, one task per position and clip.
+    std::vector<Point> Run(const std::vector<std::vector<float>>& positions)
+    {
+        const size_t clips = _corpus.size();
+        std::vector<Totals> totals(positions.size() * clips);
+        _pool.ForEach(totals.size(), [&](size_t task) {
+            const size_t p = task / clips;
+            totals[task] = Evaluate(MakeParams(positions[p]), _corpus[task % clips]);
+        });
+
+        std::vector<Point> points;
+        for (size_t p = 0; p < positions.size(); ++p)
+        {
+            Totals sum;
+            for (size_t c = 0; c < clips; ++c)
+            {
+                sum.Add(totals[(p * clips) + c]);
+            }
+            Point point;
+            point.position = positions[p];
+            point.metrics = sum.Average();
+            point.score = Score(point.metrics);
+            points.push_back(point);
+        }
+        _evaluated += positions.size();
+        return points;
+    }
+
+    double Score(const Metrics& metrics) const
+    {
+        return (_weights[0] * metrics.lock_ms / lock_reference_ms)
+            + (_weights[1] * metrics.cents / cents_reference)
+            + (_weights[2] * metrics.octave_percent / octave_reference_percent);
+    }
+
+    size_t Evaluated() const { return _evaluated; }
+
+private:
+    const std::vector<Clip>& _corpus;
+    ThreadPool& _pool;
+    std::array<double, 3> _weights;
+    size_t _evaluated = 0;
+};
+
+std::vector<std::vector<float>> GridPositions(const std::vector<float>& origin,
+    const std::vector<bool>& active, int steps)
+{
+    std::vector<std::vector<float>> positions{origin};
+    for (size_t d = 0; d < dimensions.size(); ++d)
+    {
+        if (!active[d])
+        {
+            continue;
+        }
+        std::vector<std::vector<float>> expanded;
+        for (const auto& position : positions)
+        {
+            for (int s = 0; s < steps; ++s)
+            {
+                auto next = position;
+                next[d] = (steps > 1) ? static_cast<float>(s) / static_cast<float>(steps - 1) : 0.5f;
+                expanded.push_back(next);
+            }
+        }
+        positions = std::move(expanded);
+    }
+    return positions;
+}
+
+// Compass search: polls one step either way along every active dimension,
+// all in parallel, moves to the best improvement and halves the step when
+// there is none.
+void Optimize(Explorer& explorer, Point start, const std::vector<bool>& active,
+    int iterations, std::vector<Point>& history)
+{
+    constexpr float min_step = 1.0f / 128.0f;
+    float step = 0.25f;
+    Point best = start;
+
+    for (int iteration = 0; iteration < iterations && step >= min_step; ++iteration)
+    {
+        std::vector<std::vector<float>> polls;
+        for (size_t d = 0; d < dimensions.size(); ++d)
+        {
+            if (!active[d])
+            {
+                continue;
+            }
+            for (const float direction : {-1.0f, 1.0f})
+            {
+                auto next = best.position;
+                next[d] = std::clamp(next[d] + (direction * step), 0.0f, 1.0f);
+                if (next[d] != best.position[d])
+                {
+                    polls.push_back(next);
+                }
+            }
+        }
+
+        const auto points = explorer.Run(polls);
+        history.insert(history.end(), points.begin(), points.end());
+        const auto better = std::min_element(points.begin(), points.end(),
+            [](const Point& a, const Point& b) { return a.score < b.score; });
+        if (better != points.end() && better->score < best.score)
+        {
+            best = *better;
+        }
+        else
+        {
+            step *= 0.5f;
+        }
+        printf("  iteration %d: score %.3f, step %.4f\n", iteration + 1, best.score, step);
+    }
+}
+
+void MarkPareto(std::vector<Point>& points)
+{
+    const auto dominates = [](const Metrics& a, const Metrics& b) {
+        const bool no_worse = a.lock_ms <= b.lock_ms && a.cents <= b.cents
+            && a.octave_percent <= b.octave_percent;
+        const bool better = a.lock_ms < b.lock_ms || a.cents < b.cents
+            || a.octave_percent < b.octave_percent;
+        return no_worse && better;
+    };
+    for (auto& point : points)
+    {
+        point.pareto = std::none_of(points.begin(), points.end(),
+            [&](const Point& other) { return dominates(other.metrics, point.metrics); });
+    }
+}
+
+void PrintHeader()
+{
+    printf("%-8s %8s %7s %7s %8s %3s %8s", "", "lock ms", "cents", "jitter", "octave%", "miss", "score");
+    for (const auto& dimension : dimensions)
+    {
+        printf(" %9s", dimension.name);
+    }
+    printf("\n");
+}
+
+void PrintPoint(const char* label, const Point& point)
+{
+    const auto params = MakeParams(point.position);
+    printf("%-8s %8.1f %7.2f %7.2f %8.2f %3d %8.3f", label,
+        point.metrics.lock_ms, point.metrics.cents, point.metrics.jitter_cents,
+        point.metrics.octave_percent, point.metrics.missed, point.score);
+    for (const auto& dimension : dimensions)
+    {
+        printf(" %9.4g", params.*dimension.value);
+    }
+    printf("\n");
+}
+
+void WriteJson(const std::string& path, const std::vector<Point>& points)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file)
+    {
+        fprintf(stderr, "Could not write '%s'\n", path.c_str());
+        return;
+    }
+
+    fprintf(file, "{\n  \"points\": [\n");
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        const auto& point = points[i];
+        const auto params = MakeParams(point.position);
+        fprintf(file, "    {\"lock_ms\": %.3f, \"cents\": %.3f, \"jitter_cents\": %.3f, "
+            "\"octave_percent\": %.3f, \"missed\": %d, \"score\": %.4f, \"pareto\": %s",
+            point.metrics.lock_ms, point.metrics.cents, point.metrics.jitter_cents,
+            point.metrics.octave_percent, point.metrics.missed, point.score, point.pareto ? "true" : "false");
+        for (const auto& dimension : dimensions)
+        {
+            fprintf(file, ", \"%s\": %.6g", dimension.name, params.*dimension.value);
+        }
+        fprintf(file, "}%s\n", (i + 1 < points.size()) ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+}
+
+// A C++ float literal, which needs a decimal point even for whole values.
+std::string FloatLiteral(float value)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.6g", value);
+    std::string literal = text;
+    if (literal.find_first_of(".e") == std::string::npos)
+    {
+        literal += ".0";
+    }
+    return literal + "f";
+}
+
+std::vector<std::string> Split(const std::string& text)
+{
+    std::vector<std::string> parts;
+    std::stringstream stream(text);
+    std::string part;
+    while (std::getline(stream, part, ','))
+    {
+        parts.push_back(part);
+    }
+    return parts;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    int grid_steps = 0;
+    int iterations = 0;
+    size_t threads = 0;
+    size_t top = 10;
+    std::string json_path;
+    bool compare_detectors = false;
+    std::vector<bool> active(dimensions.size(), true);
+    std::array<double, 3> weights{1.0, 1.0, 1.0};
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const auto next = [&]() -> std::string {
+            return (i + 1 < argc) ? argv[++i] : "";
+        };
+
+        if (arg == "--grid") grid_steps = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--optimize") iterations = std::max(1, std::atoi(next().c_str()));
+        else if (arg == "--threads") threads = static_cast<size_t>(std::max(1, std::atoi(next().c_str())));
+        else if (arg == "--top") top = static_cast<size_t>(std::max(1, std::atoi(next().c_str())));
+        else if (arg == "--json") json_path = next();
+        else if (arg == "--quadrature") quadrature_detector = true;
+        else if (arg == "--compare-detectors") compare_detectors = true;
+        else if (arg == "--dims")
+        {
+            std::fill(active.begin(), active.end(), false);
+            for (const auto& name : Split(next()))
+            {
+                const auto found = std::find_if(dimensions.begin(), dimensions.end(),
+                    [&](const Dimension& dimension) { return name == dimension.name; });
+                if (found == dimensions.end())
+                {
+                    fprintf(stderr, "Unknown dimension '%s'\n", name.c_str());
+                    return 1;
+                }
+                active[static_cast<size_t>(found - dimensions.begin())] = true;
+            }
+        }
+        else if (arg == "--weights")
+        {
+            const auto parts = Split(next());
+            for (size_t w = 0; w < std::min(parts.size(), weights.size()); ++w)
+            {
+                weights[w] = std::atof(parts[w].c_str());
+            }
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--grid n] [--optimize n] [--dims a,b] [--weights l,c,o] "
+                "[--threads n] [--top n] [--json file] [--quadrature] [--compare-detectors]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (grid_steps == 0 && iterations == 0)
+    {
+        iterations = 40;
+    }
+
+    const auto corpus = MakeCorpus();
+    size_t notes = 0;
+    size_t samples = 0;
+    for (const auto& clip : corpus)
+    {
+        notes += clip.notes.size();
+        samples += clip.audio.size();
+    }
+    ThreadPool pool(threads);
+    printf("Corpus: %zu clips, %zu notes, %.1f s; %zu threads\n",
+        corpus.size(), notes, static_cast<double>(samples) / sample_rate, pool.Size());
+
+    Explorer explorer(corpus, pool, weights);
+    const auto start_time = std::chrono::steady_clock::now();
+
+    if (compare_detectors)
+    {
+        PrintHeader();
+        for (const bool quadrature : {false, true})
+        {
+            quadrature_detector = quadrature;
+            PrintPoint(quadrature ? "quadrat." : "edges", explorer.Run({CurrentPosition()}).front());
+        }
+        return 0;
+    }
+
+    const Point current = explorer.Run({CurrentPosition()}).front();
+    std::vector<Point> history{current};
+
+    if (grid_steps > 0)
+    {
+        const auto positions = GridPositions(current.position, active, grid_steps);
+        printf("Grid: %zu points\n", positions.size());
+        const auto points = explorer.Run(positions);
+        history.insert(history.end(), points.begin(), points.end());
+    }
+
+    if (iterations > 0)
+    {
+        const auto best = std::min_element(history.begin(), history.end(),
+            [](const Point& a, const Point& b) { return a.score < b.score; });
+        printf("Compass search from score %.3f\n", best->score);
+        Optimize(explorer, *best, active, iterations, history);
+    }
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
+    printf("Evaluated %zu points in %.1f s\n\n", explorer.Evaluated(), elapsed.count());
+
+    // The compass search revisits points; list each one once.
+    std::vector<Point> unique;
+    for (const auto& point : history)
+    {
+        const bool seen = std::any_of(unique.begin(), unique.end(),
+            [&](const Point& other) { return other.position == point.position; });
+        if (!seen)
+        {
+            unique.push_back(point);
+        }
+    }
+    history = std::move(unique);
+
+    MarkPareto(history);
+    auto ranked = history;
+    std::sort(ranked.begin(), ranked.end(),
+        [](const Point& a, const Point& b) { return a.score < b.score; });
+
+    PrintHeader();
+    PrintPoint("current", current);
+    for (size_t i = 0; i < std::min(top, ranked.size()); ++i)
+    {
+        const std::string label = "#" + std::to_string(i + 1);
+        PrintPoint(label.c_str(), ranked[i]);
+    }
+
+    std::vector<Point> front;
+    std::copy_if(ranked.begin(), ranked.end(), std::back_inserter(front),
+        [](const Point& point) { return point.pareto; });
+    std::sort(front.begin(), front.end(),
+        [](const Point& a, const Point& b) { return a.metrics.lock_ms < b.metrics.lock_ms; });
+    printf("\nPareto front, by lock time: %zu points\n", front.size());
+    PrintHeader();
+    for (const auto& point : front)
+    {
+        PrintPoint("front", point);
+    }
+
+    const auto best_params = MakeParams(ranked.front().position);
+    printf("\nBest as PLL::Params:\n");
+    for (const auto& dimension : dimensions)
+    {
+        printf("    params.%s = %s;\n", dimension.field, FloatLiteral(best_params.*dimension.value).c_str());
+    }
+
+    const auto loop = AnalyzeLoop(LoopGains{
+        best_params.pll_kp_hz,
+        best_params.pll_ki_hz,
+        best_params.pll_error_filter_alpha,
+        best_params.pll_integrator_limit_hz,
+    });
+    printf("\nAs a LoopDesign: natural %.2f Hz, damping %.3f, lock range %.0f Hz, error filter at %.2f x natural\n",
+        loop.natural_hz, loop.damping, loop.lock_range_hz, loop.error_filter_ratio);
+
+    if (!json_path.empty())
+    {
+        WriteJson(json_path, history);
+    }
+    return 0;
+}
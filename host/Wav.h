@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Minimal mono WAV helpers for the host tools. Reads the first channel of
+// 16-bit PCM or 32-bit float files and writes 32-bit float.
+
+inline bool ReadWav(const std::string& path, std::vector<float>& samples, uint32_t* sample_rate = nullptr)
+{
+    std::ifstream file(path, std::ios::binary);
+    char riff[12];
+    if (!file.read(riff, sizeof(riff)) || std::memcmp(riff, "RIFF", 4) || std::memcmp(riff + 8, "WAVE", 4))
+    {
+        return false;
+    }
+
+    uint16_t format = 0;
+    uint16_t channels = 1;
+    uint16_t bits = 16;
+    char id[4];
+    uint32_t size = 0;
+    while (file.read(id, 4) && file.read(reinterpret_cast<char*>(&size), 4))
+    {
+        if (!std::memcmp(id, "fmt ", 4))
+        {
+            std::vector<char> fmt(size);
+            file.read(fmt.data(), size);
+            std::memcpy(&format, fmt.data(), 2);
+            std::memcpy(&channels, fmt.data() + 2, 2);
+            if (sample_rate)
+            {
+                std::memcpy(sample_rate, fmt.data() + 4, 4);
+            }
+            std::memcpy(&bits, fmt.data() + 14, 2);
+        }
+        else if (!std::memcmp(id, "data", 4))
+        {
+            const size_t frame_bytes = channels * (bits / 8);
+            std::vector<char> data(size);
+            file.read(data.data(), size);
+            for (size_t offset = 0; offset + frame_bytes <= data.size(); offset += frame_bytes)
+            {
+                if (format == 3 && bits == 32)
+                {
+                    float s;
+                    std::memcpy(&s, data.data() + offset, 4);
+                    samples.push_back(s);
+                }
+                else if (format == 1 && bits == 16)
+                {
+                    int16_t s;
+                    std::memcpy(&s, data.data() + offset, 2);
+                    samples.push_back(s / 32768.0f);
+                }
+                else
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+        else
+        {
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return false;
+}
+
+inline bool WriteWav(const std::string& path, const std::vector<float>& samples, uint32_t sample_rate)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    const auto put16 = [&](uint16_t v) { file.write(reinterpret_cast<const char*>(&v), 2); };
+    const auto put32 = [&](uint32_t v) { file.write(reinterpret_cast<const char*>(&v), 4); };
+
+    const auto data_size = static_cast<uint32_t>(samples.size() * sizeof(float));
+    file.write("RIFF", 4);
+    put32(36 + data_size);
+    file.write("WAVEfmt ", 8);
+    put32(16);
+    put16(3); // IEEE float
+    put16(1);
+    put32(sample_rate);
+    put32(sample_rate * sizeof(float));
+    put16(sizeof(float));
+    put16(32);
+    file.write("data", 4);
+    put32(data_size);
+    file.write(reinterpret_cast<const char*>(samples.data()), data_size);
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,338 @@
+#include "HostHal.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+// Bounds of the DSY_QSPI_BSS section, provided by the linker.
+extern "C" uint8_t __start_qspi_bss[];
+extern "C" uint8_t __stop_qspi_bss[];
+
+namespace host
+{
+
+namespace
+{
+
+int PinBit(daisy::Pin pin)
+{
+    return (pin.port * 16) + pin.pin;
+}
+
+size_t FlashSize()
+{
+    return static_cast<size_t>(__stop_qspi_bss - __start_qspi_bss);
+}
+
+} // namespace
+
+Hal& hal()
+{
+    static Hal instance;
+    return instance;
+}
+
+void Hal::SetPin(daisy::Pin pin, bool active)
+{
+    const auto bit = uint64_t{1} << PinBit(pin);
+    const auto previous = _pins;
+    _pins = active ? (_pins | bit) : (_pins & ~bit);
+
+    if ((_pins != previous) && (_interrupt_pins & bit))
+    {
+        HAL_GPIO_EXTI_Callback(static_cast<uint16_t>(1u << pin.pin));
+    }
+}
+
+void Hal::RouteInterrupt(daisy::Pin pin)
+{
+    _interrupt_pins |= uint64_t{1} << PinBit(pin);
+}
+
+bool Hal::PinActive(daisy::Pin pin) const
+{
+    return (_pins >> PinBit(pin)) & 1;
+}
+
+void Hal::LoadFlash(const std::string& path)
+{
+    // Fresh flash reads as erased.
+    std::fill(__start_qspi_bss, __stop_qspi_bss, 0xFF);
+    _flash_path = path;
+    if (_flash_path.empty())
+    {
+        return;
+    }
+
+    std::ifstream file(_flash_path, std::ios::binary);
+    file.read(reinterpret_cast<char*>(__start_qspi_bss), FlashSize());
+}
+
+uint8_t* Hal::FlashAddress(uint32_t address)
+{
+    // Firmware addresses are the low 32 bits of the mapped pointer.
+    const auto base = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(__start_qspi_bss));
+    const auto offset = static_cast<size_t>(address - base);
+    return (offset <= FlashSize()) ? (__start_qspi_bss + offset) : nullptr;
+}
+
+void Hal::FlushFlash()
+{
+    if (_flash_path.empty())
+    {
+        return;
+    }
+
+    std::ofstream file(_flash_path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(__start_qspi_bss), FlashSize());
+}
+
+void Hal::AdvanceBlock()
+{
+    if (_sample_clock >= end_sample)
+    {
+        throw SimulationComplete{};
+    }
+
+    before_block(_sample_clock);
+
+    const auto size = std::min(_block_size, max_block_size);
+    if (_callback)
+    {
+        std::array<float, max_block_size> in_left{};
+        std::array<float, max_block_size> in_right{};
+        std::array<float, max_block_size> out_left{};
+        std::array<float, max_block_size> out_right{};
+        for (size_t i = 0; i < size; ++i)
+        {
+            in_left[i] = input();
+            in_right[i] = in_left[i];
+        }
+
+        const float* in[] = {in_left.data(), in_right.data()};
+        float* out[] = {out_left.data(), out_right.data()};
+        _callback(in, out, size);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            output(out_left[i]);
+        }
+    }
+
+    _sample_clock += size;
+}
+
+} // namespace host
+
+HostCycleCounter::operator uint32_t() const
+{
+    const auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    return static_cast<uint32_t>((static_cast<uint64_t>(ns) * (SystemCoreClock / 1000000u)) / 1000u);
+}
+
+void dsy_gpio_init(const dsy_gpio* p)
+{
+    (void)p;
+}
+
+uint8_t dsy_gpio_read(const dsy_gpio* p)
+{
+    // Inputs are pulled up, so an active (pressed) pin reads low.
+    const daisy::Pin pin{p->pin.port, p->pin.pin};
+    return host::hal().PinActive(pin) ? 0 : 1;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init)
+{
+    for (uint8_t pin = 0; pin < 16; ++pin)
+    {
+        if ((init->Pin & (1u << pin)) && init->Mode == GPIO_MODE_IT_RISING_FALLING)
+        {
+            host::hal().RouteInterrupt(daisy::Pin{port->port, pin});
+        }
+    }
+}
+
+namespace daisy
+{
+
+uint32_t System::GetNow()
+{
+    const auto& hal = host::hal();
+    return static_cast<uint32_t>((hal.Now() * 1000) / static_cast<uint64_t>(hal.SampleRate()));
+}
+
+uint32_t System::GetUs()
+{
+    const auto& hal = host::hal();
+    return static_cast<uint32_t>((hal.Now() * 1000000) / static_cast<uint64_t>(hal.SampleRate()));
+}
+
+uint32_t System::GetTick()
+{
+    auto& hal = host::hal();
+    hal.AdvanceBlock();
+    return static_cast<uint32_t>(hal.Now());
+}
+
+uint32_t System::GetTickFreq()
+{
+    return static_cast<uint32_t>(host::hal().SampleRate());
+}
+
+void System::Delay(uint32_t delay_ms)
+{
+    const auto end = GetNow() + delay_ms;
+    while (GetNow() < end)
+    {
+        host::hal().AdvanceBlock();
+    }
+}
+
+void AdcHandle::Init(AdcChannelConfig* cfg, size_t num_channels)
+{
+    (void)cfg;
+    (void)num_channels;
+}
+
+uint16_t* AdcHandle::GetPtr(uint8_t chn)
+{
+    return &host::hal().adc[chn % host::Hal::adc_channels];
+}
+
+void AnalogControl::Init(uint16_t* adcptr, float sr, bool flip, bool invert, float slew_seconds)
+{
+    (void)flip;
+    (void)invert;
+    _adc = adcptr;
+    _slew_seconds = slew_seconds;
+    SetSampleRate(sr);
+}
+
+float AnalogControl::Process()
+{
+    const float target = static_cast<float>(*_adc) / 65535.0f;
+    _val += _coeff * (target - _val);
+    return _val;
+}
+
+void AnalogControl::SetSampleRate(float sample_rate)
+{
+    _coeff = std::min(1.0f, 1.0f / (_slew_seconds * sample_rate));
+}
+
+void Switch::Init(Pin pin, float update_rate)
+{
+    (void)update_rate;
+    _pin = pin;
+    _state = 0x00;
+}
+
+void Switch::Debounce()
+{
+    _state = static_cast<uint8_t>((_state << 1) | (RawState() ? 1 : 0));
+    if (RisingEdge())
+    {
+        _rising_edge_time = System::GetNow();
+    }
+}
+
+bool Switch::RawState() const
+{
+    return host::hal().PinActive(_pin);
+}
+
+float Switch::TimeHeldMs() const
+{
+    return Pressed() ? static_cast<float>(System::GetNow() - _rising_edge_time) : 0.0f;
+}
+
+DacHandle::Result DacHandle::WriteValue(Channel chn, uint16_t val)
+{
+    const int index = (chn == Channel::TWO) ? 1 : 0;
+    host::hal().dac[index] = static_cast<float>(val) / 4095.0f;
+    return Result::OK;
+}
+
+void MidiUartHandler::SendMessage(uint8_t* bytes, size_t size)
+{
+    host::hal().midi_output(bytes, size);
+}
+
+void DaisySeed::Init(bool boost)
+{
+    (void)boost;
+}
+
+void DaisySeed::SetAudioBlockSize(size_t blocksize)
+{
+    host::hal().SetBlockSize(blocksize);
+}
+
+void DaisySeed::SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate)
+{
+    using SampleRate = SaiHandle::Config::SampleRate;
+    switch (samplerate)
+    {
+        case SampleRate::SAI_8KHZ: host::hal().SetSampleRate(8000.0f); break;
+        case SampleRate::SAI_16KHZ: host::hal().SetSampleRate(16000.0f); break;
+        case SampleRate::SAI_32KHZ: host::hal().SetSampleRate(32000.0f); break;
+        case SampleRate::SAI_48KHZ: host::hal().SetSampleRate(48000.0f); break;
+        case SampleRate::SAI_96KHZ: host::hal().SetSampleRate(96000.0f); break;
+    }
+}
+
+float DaisySeed::AudioSampleRate()
+{
+    return host::hal().SampleRate();
+}
+
+size_t DaisySeed::AudioBlockSize()
+{
+    return host::hal().BlockSize();
+}
+
+float DaisySeed::AudioCallbackRate()
+{
+    return AudioSampleRate() / static_cast<float>(AudioBlockSize());
+}
+
+void DaisySeed::StartAudio(AudioHandle::AudioCallback cb)
+{
+    host::hal().StartAudio(cb);
+}
+
+QSPIHandle::Result QSPIHandle::Erase(uint32_t start_addr, uint32_t end_addr)
+{
+    auto& hal = host::hal();
+    auto* begin = hal.FlashAddress(start_addr);
+    auto* end = hal.FlashAddress(end_addr);
+    if (!begin || !end || end < begin)
+    {
+        return Result::ERR;
+    }
+    std::fill(begin, end, 0xFF);
+    hal.FlushFlash();
+    return Result::OK;
+}
+
+QSPIHandle::Result QSPIHandle::Write(uint32_t address, uint32_t size, uint8_t* buffer)
+{
+    auto& hal = host::hal();
+    auto* dest = hal.FlashAddress(address);
+    if (!dest || !hal.FlashAddress(address + size))
+    {
+        return Result::ERR;
+    }
+    // NOR flash can only clear bits.
+    for (uint32_t i = 0; i < size; ++i)
+    {
+        dest[i] &= buffer[i];
+    }
+    hal.FlushFlash();
+    return Result::OK;
+}
+
+} // namespace daisy
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include <daisy_seed.h>
+
+// Simulation side of the host libDaisy stand-ins.
+//
+// Time is virtual and counted in audio samples. Every call to
+// daisy::System::GetTick() renders one audio block, so the firmware's
+// busy-wait in Terrarium::Loop drives the audio callback and the whole
+// firmware runs as fast as the host can compute it.
+namespace host
+{
+
+// Thrown from the virtual clock once the run is over, to unwind out of the
+// firmware's endless control loop.
+struct SimulationComplete
+{
+};
+
+class Hal
+{
+public:
+    static constexpr int adc_channels = 8;
+    static constexpr int dac_channels = 2;
+
+    // Harness hooks.
+    std::function<float()> input = [] { return 0.0f; };
+    std::function<void(float)> output = [](float) {};
+    // Called before every audio block with the current sample time.
+    std::function<void(uint64_t)> before_block = [](uint64_t) {};
+    // Bytes sent by daisy::MidiUartHandler.
+    std::function<void(const uint8_t*, size_t)> midi_output = [](const uint8_t*, size_t) {};
+    uint64_t end_sample = UINT64_MAX;
+
+    // Control surface state.
+    std::array<uint16_t, adc_channels> adc{};
+    std::array<float, dac_channels> dac{};
+    void SetPin(daisy::Pin pin, bool active);
+    bool PinActive(daisy::Pin pin) const;
+    // Pins set up for EXTI raise their interrupt when SetPin() changes them.
+    void RouteInterrupt(daisy::Pin pin);
+
+    // File backing for the QSPI flash region; empty means RAM only.
+    void LoadFlash(const std::string& path);
+    uint8_t* FlashAddress(uint32_t address);
+    void FlushFlash();
+
+    // Virtual clock.
+    uint64_t Now() const { return _sample_clock; }
+    float SampleRate() const { return _sample_rate; }
+    void AdvanceBlock();
+
+    // Firmware-facing state set through the stand-ins.
+    void SetSampleRate(float sample_rate) { _sample_rate = sample_rate; }
+    void SetBlockSize(size_t block_size) { _block_size = block_size; }
+    size_t BlockSize() const { return _block_size; }
+    void StartAudio(daisy::AudioHandle::AudioCallback callback) { _callback = callback; }
+
+private:
+    static constexpr size_t max_block_size = 256;
+
+    uint64_t _sample_clock = 0;
+    float _sample_rate = 48000.0f;
+    size_t _block_size = 48;
+    daisy::AudioHandle::AudioCallback _callback = nullptr;
+    uint64_t _pins = 0;
+    uint64_t _interrupt_pins = 0;
+    std::string _flash_path;
+};
+
+Hal& hal();
+
+} // namespace host
@@ -0,0 +1,282 @@
+#pragma once
+
+// Host stand-in for the parts of libDaisy used by this firmware.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+
+#include <per/qspi.h>
+#include <per/sai.h>
+
+#ifdef TERRARIUM_BENCH_CORTEX_M7
+// The benchmark on the target: libDaisy's section names, for its linker
+// script.
+#define DSY_SDRAM_BSS __attribute__((section(".sdram_bss")))
+#define DTCM_MEM_SECTION __attribute__((section(".dtcmram_bss")))
+#else
+#define DSY_SDRAM_BSS
+#define DTCM_MEM_SECTION
+#endif
+
+// Cortex-M7 cycle counter. On the host it counts wall-clock time at the
+// Seed's boosted core clock, so firmware timing code runs unchanged.
+struct HostCycleCounter
+{
+    operator uint32_t() const;
+    HostCycleCounter& operator=(uint32_t) { return *this; }
+};
+struct HostDwt
+{
+    uint32_t CTRL = 0;
+    HostCycleCounter CYCCNT;
+};
+struct HostCoreDebug
+{
+    uint32_t DEMCR = 0;
+};
+inline HostDwt host_dwt;
+inline HostCoreDebug host_core_debug;
+inline uint32_t SystemCoreClock = 480000000;
+#define DWT (&host_dwt)
+#define CoreDebug (&host_core_debug)
+#define DWT_CTRL_CYCCNTENA_Msk (1UL)
+#define CoreDebug_DEMCR_TRCENA_Msk (1UL << 24)
+
+// STM32 HAL pieces used to route switch pins to EXTI interrupts. On the
+// host, Hal::SetPin() raises HAL_GPIO_EXTI_Callback() for routed pins.
+struct GPIO_TypeDef
+{
+    int port;
+};
+inline GPIO_TypeDef host_gpio_ports[7]{{0}, {1}, {2}, {3}, {4}, {5}, {6}};
+#define GPIOA (&host_gpio_ports[0])
+#define GPIOB (&host_gpio_ports[1])
+#define GPIOC (&host_gpio_ports[2])
+#define GPIOD (&host_gpio_ports[3])
+#define GPIOE (&host_gpio_ports[4])
+#define GPIOF (&host_gpio_ports[5])
+#define GPIOG (&host_gpio_ports[6])
+typedef struct
+{
+    uint32_t Pin;
+    uint32_t Mode;
+    uint32_t Pull;
+    uint32_t Speed;
+    uint32_t Alternate;
+} GPIO_InitTypeDef;
+#define GPIO_MODE_IT_RISING_FALLING (0x10310000UL)
+#define GPIO_PULLUP (0x1UL)
+#define GPIO_SPEED_FREQ_LOW (0x0UL)
+#define GPIO_PIN_0 ((uint16_t)0x0001)
+#define GPIO_PIN_1 ((uint16_t)0x0002)
+#define GPIO_PIN_2 ((uint16_t)0x0004)
+#define GPIO_PIN_3 ((uint16_t)0x0008)
+#define GPIO_PIN_4 ((uint16_t)0x0010)
+#define GPIO_PIN_5 ((uint16_t)0x0020)
+#define GPIO_PIN_9 ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+typedef enum
+{
+    EXTI0_IRQn = 6,
+    EXTI1_IRQn = 7,
+    EXTI2_IRQn = 8,
+    EXTI3_IRQn = 9,
+    EXTI4_IRQn = 10,
+    EXTI9_5_IRQn = 23,
+    EXTI15_10_IRQn = 40,
+} IRQn_Type;
+#define __HAL_RCC_SYSCFG_CLK_ENABLE() do {} while (0)
+void HAL_GPIO_Init(GPIO_TypeDef* port, GPIO_InitTypeDef* init);
+inline void HAL_NVIC_SetPriority(IRQn_Type, uint32_t, uint32_t) {}
+inline void HAL_NVIC_EnableIRQ(IRQn_Type) {}
+inline void HAL_GPIO_EXTI_IRQHandler(uint16_t) {}
+extern "C" void HAL_GPIO_EXTI_Callback(uint16_t gpio_pin);
+
+typedef struct { int port; uint8_t pin; } dsy_gpio_pin;
+typedef enum { DSY_GPIO_MODE_INPUT, DSY_GPIO_MODE_OUTPUT_PP } dsy_gpio_mode;
+typedef enum { DSY_GPIO_NOPULL, DSY_GPIO_PULLUP, DSY_GPIO_PULLDOWN } dsy_gpio_pull;
+typedef struct { dsy_gpio_pin pin; dsy_gpio_mode mode; dsy_gpio_pull pull; } dsy_gpio;
+
+void dsy_gpio_init(const dsy_gpio* p);
+uint8_t dsy_gpio_read(const dsy_gpio* p);
+
+namespace daisy
+{
+struct Pin
+{
+    int port = 0;
+    uint8_t pin = 0;
+
+    constexpr Pin() = default;
+    constexpr Pin(int port_, uint8_t pin_) : port(port_), pin(pin_) {}
+    operator dsy_gpio_pin() const { return {port, pin}; }
+};
+
+namespace seed
+{
+// Port/pin pairs follow the Daisy Seed pinout.
+constexpr Pin D4{2, 8};
+constexpr Pin D5{3, 2};
+constexpr Pin D6{2, 12};
+constexpr Pin D7{6, 10};
+constexpr Pin D8{6, 11};
+constexpr Pin D9{1, 4};
+constexpr Pin D10{1, 5};
+constexpr Pin D11{1, 8};
+constexpr Pin D12{1, 9};
+constexpr Pin D25{0, 0};
+constexpr Pin D26{3, 11};
+constexpr Pin A1{0, 3};
+constexpr Pin A2{1, 1};
+constexpr Pin A3{0, 7};
+constexpr Pin A4{0, 6};
+constexpr Pin A5{2, 1};
+constexpr Pin A6{2, 4};
+} // namespace seed
+
+// Interrupts are never concurrent on the host.
+class ScopedIrqBlocker
+{
+public:
+    ScopedIrqBlocker() {}
+};
+
+class System
+{
+public:
+    static uint32_t GetNow();
+    static uint32_t GetUs();
+    static uint32_t GetTick();
+    static uint32_t GetTickFreq();
+    static void Delay(uint32_t delay_ms);
+};
+
+struct AdcChannelConfig
+{
+    void InitSingle(Pin pin) { this->pin = pin; }
+    Pin pin;
+};
+
+class AdcHandle
+{
+public:
+    void Init(AdcChannelConfig* cfg, size_t num_channels);
+    void Start() {}
+    uint16_t* GetPtr(uint8_t chn);
+};
+
+class AnalogControl
+{
+public:
+    void Init(uint16_t* adcptr, float sr, bool flip = false, bool invert = false, float slew_seconds = 0.002f);
+    float Process();
+    float Value() const { return _val; }
+    void SetSampleRate(float sample_rate);
+
+private:
+    uint16_t* _adc = nullptr;
+    float _coeff = 1.0f;
+    float _slew_seconds = 0.002f;
+    float _val = 0.0f;
+};
+
+class Switch
+{
+public:
+    void Init(Pin pin, float update_rate = 0.0f);
+    void Debounce();
+    bool Pressed() const { return _state == 0xFF; }
+    bool RisingEdge() const { return _state == 0x7F; }
+    bool FallingEdge() const { return _state == 0x80; }
+    bool RawState() const;
+    float TimeHeldMs() const;
+
+private:
+    Pin _pin;
+    uint8_t _state = 0x00;
+    uint32_t _rising_edge_time = 0;
+};
+
+class DacHandle
+{
+public:
+    enum class Result { OK, ERR };
+    enum class Channel { ONE, TWO, BOTH };
+    enum class Mode { POLLING, DMA };
+    enum class BitDepth { BITS_8, BITS_12 };
+    enum class BufferState { ENABLED, DISABLED };
+
+    struct Config
+    {
+        uint32_t target_samplerate;
+        Channel chn;
+        Mode mode;
+        BitDepth bitdepth;
+        BufferState buff_state;
+    };
+
+    Result Init(const Config& config) { (void)config; return Result::OK; }
+    Result WriteValue(Channel chn, uint16_t val);
+};
+
+// Nothing calls the period callback on the host.
+class TimerHandle
+{
+public:
+    enum class Result { OK, ERR };
+    typedef void (*PeriodElapsedCallback)(void* data);
+
+    struct Config
+    {
+        enum class Peripheral { TIM_2, TIM_3, TIM_4, TIM_5 };
+        enum class CounterDir { UP, DOWN };
+
+        Peripheral periph = Peripheral::TIM_2;
+        CounterDir dir = CounterDir::UP;
+        bool enable_irq = false;
+    };
+
+    Result Init(const Config& config) { (void)config; return Result::OK; }
+    Result SetPeriod(uint32_t ticks) { (void)ticks; return Result::OK; }
+    uint32_t GetFreq() { return 200000000; }
+    void SetCallback(PeriodElapsedCallback cb, void* data = nullptr) { (void)cb; (void)data; }
+    Result Start() { return Result::OK; }
+};
+
+// Sent bytes go to host::Hal::midi_output.
+class MidiUartHandler
+{
+public:
+    struct Config
+    {
+    };
+
+    void Init(Config config) { (void)config; }
+    void SendMessage(uint8_t* bytes, size_t size);
+};
+
+class AudioHandle
+{
+public:
+    typedef const float* const* InputBuffer;
+    typedef float** OutputBuffer;
+    typedef void (*AudioCallback)(InputBuffer in, OutputBuffer out, size_t size);
+};
+
+class DaisySeed
+{
+public:
+    void Init(bool boost = false);
+    void SetAudioBlockSize(size_t blocksize);
+    void SetAudioSampleRate(SaiHandle::Config::SampleRate samplerate);
+    float AudioSampleRate();
+    size_t AudioBlockSize();
+    float AudioCallbackRate();
+    void StartAudio(AudioHandle::AudioCallback cb);
+
+    AdcHandle adc;
+    QSPIHandle qspi;
+};
+} // namespace daisy
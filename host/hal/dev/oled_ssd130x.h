@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+
+namespace daisy
+{
+enum class Alignment { centered, topLeft };
+
+struct Rectangle
+{
+    int x = 0, y = 0, width = 128, height = 64;
+};
+
+struct FontDef
+{
+    uint8_t width;
+    uint8_t height;
+};
+
+class SSD130xI2c128x64Driver
+{
+public:
+    struct Config
+    {
+        struct
+        {
+            struct
+            {
+                struct { Pin scl; Pin sda; } pin_config;
+            } i2c_config;
+        } transport_config;
+    };
+};
+
+template <typename Driver>
+class OledDisplay
+{
+public:
+    struct Config
+    {
+        typename Driver::Config driver_config;
+    };
+
+    void Init(const Config& config) { (void)config; }
+    void Fill(bool on) { (void)on; }
+    void SetCursor(uint16_t x, uint16_t y) { (void)x; (void)y; }
+    Rectangle GetBounds() const { return {}; }
+    char WriteStringAligned(const char* str, const FontDef& font, Rectangle bounds, Alignment alignment, bool on)
+    {
+        (void)str; (void)font; (void)bounds; (void)alignment; (void)on;
+        return 0;
+    }
+    void Update() {}
+};
+} // namespace daisy
+
+inline constexpr daisy::FontDef Font_11x18{11, 18};
+inline constexpr daisy::FontDef Font_7x10{7, 10};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Settings flash lives in its own section so the host QSPI stand-in can find
+// and persist it.
+#define DSY_QSPI_BSS __attribute__((section("qspi_bss")))
+
+namespace daisy
+{
+class QSPIHandle
+{
+public:
+    enum class Result { OK, ERR };
+
+    Result Erase(uint32_t start_addr, uint32_t end_addr);
+    Result Write(uint32_t address, uint32_t size, uint8_t* buffer);
+};
+} // namespace daisy
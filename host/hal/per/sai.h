@@ -0,0 +1,20 @@
+#pragma once
+
+namespace daisy
+{
+class SaiHandle
+{
+public:
+    struct Config
+    {
+        enum class SampleRate
+        {
+            SAI_8KHZ,
+            SAI_16KHZ,
+            SAI_32KHZ,
+            SAI_48KHZ,
+            SAI_96KHZ,
+        };
+    };
+};
+} // namespace daisy
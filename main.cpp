@@ -1,37 +1,67 @@
 #include <algorithm>
 #include <array>
+#include <cmath>
+#include <cstdio>
 
 #include <per/sai.h>
 
+#include <util/AudioWatchdog.h>
+#include <util/Capture.h>
+#include <util/Controls.h>
+#include <util/Convolver.h>
+#include <util/Echo.h>
 #include <util/LinearRamp.h>
-#include <util/Mapping.h>
+#include <util/MidiOut.h>
 #include <util/PersistentSettings.h>
 #include <util/PLL.h>
+#include <util/SwitchEvents.h>
+#include <util/TapTempo.h>
 #include <util/Terrarium.h>
+#include <util/TuningMenu.h>
 
 namespace
 {
 Terrarium terrarium;
 PLL pll;
+Capture capture;
+AudioWatchdog watchdog;
+MidiOut midi_out;
+Echo echo;
+Convolver cabinet;
 
 PLL::Params params;
 volatile bool effect_enabled = true;
+// Set once the echo and the cabinet are set up, after audio has started.
+volatile bool wet_stages_ready = false;
+// Audio callback only: the echo and the cabinet were reset for a bypass.
+bool wet_stages_idle = false;
+LinearRamp bypass_fade{1.0f, 0.0f};
 volatile float output_master_level = 0.7f;
+volatile uint32_t first_audio_us = 0;
+uint32_t last_callback_us = 0;
+
+constexpr float control_rate_hz = 200.0f;
+constexpr float preset_morph_ms = 400.0f;
+// Tempo echo, on while the vibrato switch is.
+constexpr float echo_level = 0.35f;
+constexpr float echo_feedback = 0.4f;
+
+// Selected by holding the right stomp at power-on, which steps to the next
+// mode and stores it. The DSP derives its coefficients from the rate, so the
+// modes only trade CPU load against latency.
+constexpr std::array<daisy::SaiHandle::Config::SampleRate, 3> audio_rate_modes{
+    daisy::SaiHandle::Config::SampleRate::SAI_48KHZ,
+    daisy::SaiHandle::Config::SampleRate::SAI_32KHZ,
+    daisy::SaiHandle::Config::SampleRate::SAI_96KHZ,
+};
 
-constexpr float alpha_baseline = 0.017825f; // prior sweet spot at knob 3 = 35%
-constexpr LinearMapping wave_shape_mapping{0.0f, 3.0f};
-constexpr LinearMapping fuzz_level_mapping{0.0f, 2.0f};
-constexpr LinearMapping master_level_mapping{0.0f, 1.5f};
-constexpr float final_output_trim = 0.2f;
-
-float CenteredStability(float knob_ratio);
-float QuantizedPitchMultiplier(float knob_ratio);
-float QuantizedSubIntervalMultiplier(float knob_ratio);
-
-struct ControlState
-{
-    std::array<float, 6> knobs{};
-    std::array<bool, 4> toggles{};
+// How the boot message names the main voice modes. Selected by holding the
+// left stomp at power-on.
+constexpr std::array<const char*, voice_mode_count> voice_modes{
+    "",
+    ", chord tracking",
+    ", resynthesis",
+    ", harmony",
 };
 
 StoredControlState ToStoredControlState(const ControlState& state)
@@ -63,10 +93,7 @@ ControlState ReadControlState(
     daisy::AnalogControl& knob_sub_multiplier,
     daisy::AnalogControl& knob_sub_level,
     daisy::AnalogControl& knob_master_level,
-    daisy::Switch& toggle_fuzz_on,
-    daisy::Switch& toggle_osc_on,
-    daisy::Switch& toggle_sub_on,
-    daisy::Switch& toggle_osc_fx_bypass)
+    const SwitchEvents& switches)
 {
     ControlState state{};
     state.knobs[0] = knob_osc_multiplier.Process();
@@ -76,103 +103,66 @@ ControlState ReadControlState(
     state.knobs[4] = knob_sub_level.Process();
     state.knobs[5] = knob_master_level.Process();
 
-    state.toggles[0] = toggle_fuzz_on.Pressed();
-    state.toggles[1] = toggle_osc_on.Pressed();
-    state.toggles[2] = toggle_sub_on.Pressed();
-    state.toggles[3] = toggle_osc_fx_bypass.Pressed();
+    // Switch 1: fuzz, 2: osc, 3: sub, 4: vibrato mode.
+    for (size_t i = 0; i < state.toggles.size(); ++i)
+    {
+        state.toggles[i] = switches.Pressed(SwitchEvent::Source::Toggle, i);
+    }
     return state;
 }
 
-void ApplyControlState(const ControlState& state, PLL::Params& params)
-{
-    params.trigger_ratio = 0.3f;
-    params.noise_mode = false;
-    params.raw_osc_only = false;
-    params.gate_enabled = true;
-    params.envelope_follow = false;
-
-    // Switch 1: fuzz on/off, knob 2 sets fuzz level.
-    params.fuzz_level = state.toggles[0]
-        ? fuzz_level_mapping(state.knobs[1])
-        : 0.0f;
-    // Switch 2: oscillator on/off.
-    params.osc_level = state.toggles[1] ? 0.5f : 0.0f;
-    // Switch 3: sub oscillator on/off.
-    params.sub_enabled = state.toggles[2];
-    params.sub_level = params.sub_enabled ? state.knobs[4] : 0.0f;
-    // Switch 4: osc-fx bypass (on = raw oscillator voice).
-    params.vibrato_mode = state.toggles[3];
-
-    // Knob 6 controls overall output level at the final output stage.
-    output_master_level = master_level_mapping(state.knobs[5]);
-    params.master_level = 1.0f;
-
-    // Wave shapes fixed to square.
-    params.wave_shape = 1.0f;
-    params.sub_wave_shape = 1.0f;
-
-    // Knob 1 and 4 are categorical pitch multiplier controls.
-    params.main_pitch_multiplier = QuantizedPitchMultiplier(state.knobs[0]);
-    params.sub_pitch_multiplier = QuantizedSubIntervalMultiplier(state.knobs[3]);
-
-    // Compress glide control into upper half of the knob so 50% now
-    // matches the previous slowest setting and the rest sweeps faster.
-    const float glide_shifted = std::clamp((state.knobs[2] - 0.5f) * 2.0f, 0.0f, 1.0f);
-    params.glide_speed = (state.knobs[2] > 0.97f) ? 1.0f : std::pow(glide_shifted, 3.0f);
-
-    // Stability fixed to midpoint (50%).
-    params.pll_error_filter_alpha = CenteredStability(0.5f);
-}
-
-float CenteredStability(float knob_ratio)
+void RenderAudio(const float* in, float* left, float* right, size_t begin, size_t end)
 {
-    constexpr float min_value = 0.0005f;
-    constexpr float max_value = 0.05f;
-    const float normalized = (knob_ratio - 0.5f) * 2.0f;
-    const float range = (max_value - min_value) * 0.5f;
-    return std::clamp(alpha_baseline + (normalized * range), min_value, max_value);
-}
+    const bool ready = wet_stages_ready;
+    const bool enabled = effect_enabled && ready;
+    if (!enabled && bypass_fade.Value() <= 0.0f)
+    {
+        // Fully bypassed, or still setting up: only keep the loop locked
+        // for a quick return. The echo and the cabinet are left idle,
+        // cleared once on the way in so they come back silent.
+        if (ready && !wet_stages_idle)
+        {
+            echo.Reset();
+            cabinet.Reset();
+            wet_stages_idle = true;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            const float dry_signal = in[i];
+            pll.Track(dry_signal);
+            midi_out.Process(pll);
 
-float QuantizedPitchMultiplier(float knob_ratio)
-{
-    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
-    const int bucket = static_cast<int>(clamped * 10.0f);
+            left[i] = std::clamp(dry_signal, -1.0f, 1.0f);
+            right[i] = 0.0f;
+        }
+        return;
+    }
+    wet_stages_idle = false;
 
-    switch (bucket)
+    // The wet signal is staged in the unused right channel so the echo and
+    // the cabinet work on the whole span at once.
+    for (size_t i = begin; i < end; ++i)
     {
-        case 0: return 1.0f; // 0-10%
-        case 1: return 2.0f; // 10-20%
-        case 2: return 2.0f;
-        case 3: return 2.5f;
-        case 4: return 3.0f;
-        case 5: return 3.0f;
-        case 6: return 3.5f;
-        default: return 4.0f; // up to +2 octaves
+        const float mixed_signal = pll.Process(in[i]);
+        midi_out.Process(pll);
+        right[i] = (mixed_signal * output_master_level * final_output_trim);
+    }
+    echo.Process(right + begin, end - begin);
+    if (cabinet.Active())
+    {
+        cabinet.Process(right + begin, end - begin);
     }
-}
-
-float QuantizedSubIntervalMultiplier(float knob_ratio)
-{
-    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
-    const int bucket = static_cast<int>(clamped * 10.0f);
 
-    // Categorical intervals below the main oscillator.
-    // Includes musical intervals: perfect fourth below (x0.75) and
-    // perfect fifth below (x2/3), plus octave divisions.
-    switch (bucket)
+    for (size_t i = begin; i < end; ++i)
     {
-        case 0:
-        case 1: return 0.75f;                // perfect fourth below
-        case 2:
-        case 3: return 2.0f / 3.0f;          // perfect fifth below
-        case 4:
-        case 5: return 0.5f;                 // -1 octave
-        case 6: return 1.0f / 3.0f;          // octave + fifth below
-        case 7:
-        case 8: return 0.25f;                // -2 octaves
-        default: return 0.125f;              // -3 octaves
+        const float fade = bypass_fade(enabled ? 1.0f : 0.0f);
+        const float output = std::lerp(in[i], right[i], fade);
+
+        left[i] = std::clamp(output, -1.0f, 1.0f);
+        right[i] = 0.0f;
     }
 }
+
 }
 
 void processAudioBlock(
@@ -180,69 +170,120 @@ void processAudioBlock(
     daisy::AudioHandle::OutputBuffer out,
     size_t size)
 {
-    for (size_t i = 0; i < size; ++i)
+    watchdog.BeginBlock();
+
+    if (first_audio_us == 0)
     {
-        const float dry_signal = in[0][i];
-        const float mixed_signal = pll.Process(dry_signal);
-        const float wet_signal = (mixed_signal * output_master_level * final_output_trim);
-        const float output = effect_enabled ? wet_signal : dry_signal;
+        first_audio_us = daisy::System::GetUs();
+    }
+
+    capture.RecordInput(in[0], size);
+    const uint32_t block_sample = capture.Now() - static_cast<uint32_t>(size);
+    pll.BeginBlock(size);
 
-        out[0][i] = std::clamp(output, -1.0f, 1.0f);
-        out[1][i] = 0.0f;
+    // This block's input was captured since the previous callback, so a
+    // bypass press is placed at the same position within it.
+    const uint32_t block_start_us = last_callback_us;
+    last_callback_us = daisy::System::GetUs();
+    const auto block_us = static_cast<int32_t>(std::max<uint32_t>(last_callback_us - block_start_us, 1));
+
+    auto& events = terrarium.switch_events.AudioEvents();
+    SwitchEvent event;
+    size_t begin = 0;
+    while (begin < size)
+    {
+        size_t end = size;
+        const bool pending = events.Peek(event);
+        if (pending && !(event.index == 0 && event.pressed))
+        {
+            events.Pop(event);
+            continue;
+        }
+        if (pending)
+        {
+            const auto offset_us = std::clamp(
+                static_cast<int32_t>(event.time_us - block_start_us), 0, block_us);
+            end = std::max(begin, (static_cast<size_t>(offset_us) * size) / static_cast<size_t>(block_us));
+        }
+
+        RenderAudio(in[0], out[0], out[1], begin, end);
+
+        if (pending)
+        {
+            events.Pop(event);
+            effect_enabled = !effect_enabled;
+            capture.LogBypass(effect_enabled, block_sample + static_cast<uint32_t>(end));
+        }
+        begin = end;
     }
+
+    watchdog.EndBlock();
 }
 
 int main()
 {
-    terrarium.Init(true, false, false);
-    terrarium.seed.SetAudioBlockSize(16);
-    terrarium.seed.SetAudioSampleRate(daisy::SaiHandle::Config::SampleRate::SAI_48KHZ);
+    // Critical path first: codec, PLL and persisted bypass state, then audio.
+    // The display, encoder, echo and cabinet finish setting up from the
+    // control loop.
+    terrarium.Init(true, true, true);
+
+    Settings persisted = loadSettings();
+    effect_enabled = (persisted.effect_enabled != 0);
+
+    if (persisted.audio_rate_mode >= audio_rate_modes.size())
+    {
+        persisted.audio_rate_mode = 0;
+    }
+    if (terrarium.stomps[1].RawState())
+    {
+        persisted.audio_rate_mode = (persisted.audio_rate_mode + 1) % audio_rate_modes.size();
+        saveSettings(terrarium.seed.qspi, persisted);
+    }
+    if (persisted.voice_mode >= voice_modes.size())
+    {
+        persisted.voice_mode = 0;
+    }
+    if (terrarium.stomps[0].RawState())
+    {
+        persisted.voice_mode = (persisted.voice_mode + 1) % voice_modes.size();
+        saveSettings(terrarium.seed.qspi, persisted);
+    }
+
+    terrarium.seed.SetAudioBlockSize(2);
+    terrarium.seed.SetAudioSampleRate(audio_rate_modes[persisted.audio_rate_mode]);
 
     pll.Init(terrarium.seed.AudioSampleRate());
 
+    PLL::Params base_params = DefaultParams();
+    ApplyVoiceMode(persisted.voice_mode, base_params);
+    ApplyTuning(persisted.tuning, base_params);
+    params = base_params;
+    pll.SetParams(params);
+
+    // Starts bypassed and fades in once the wet stages are ready.
+    bypass_fade = LinearRamp{
+        0.0f,
+        1000.0f / (bypass_crossfade_ms * terrarium.seed.AudioSampleRate())};
+
+    midi_out.Init(terrarium.seed.AudioSampleRate());
+    capture.Init(terrarium.seed.AudioSampleRate(), terrarium.seed.AudioBlockSize());
+    capture.LogBypass(effect_enabled, capture.Now());
+    capture.LogVoiceMode(persisted.voice_mode);
+    capture.LogTuning(persisted.tuning);
+    watchdog.Init(terrarium.seed.AudioSampleRate(), terrarium.seed.AudioBlockSize());
+    watchdog.SetConfig(params);
+
+    terrarium.seed.StartAudio(processAudioBlock);
+
     auto& knob_osc_multiplier = terrarium.knobs[0];
     auto& knob_fuzz_level = terrarium.knobs[1];
     auto& knob_glide = terrarium.knobs[2];
     auto& knob_sub_multiplier = terrarium.knobs[3];
     auto& knob_sub_level = terrarium.knobs[4];
     auto& knob_master_level = terrarium.knobs[5];
-    auto& toggle_fuzz_on = terrarium.toggles[0];
-    auto& toggle_osc_on = terrarium.toggles[1];
-    auto& toggle_sub_on = terrarium.toggles[2];
-    auto& toggle_vibrato_mode = terrarium.toggles[3];
-    auto& stomp_effect = terrarium.stomps[0];
-    auto& stomp_preset = terrarium.stomps[1];
     auto& led_effect = terrarium.leds[0];
     auto& led_preset = terrarium.leds[1];
 
-    terrarium.seed.SetAudioBlockSize(2);
-
-    terrarium.seed.StartAudio(processAudioBlock);
-
-    // Temporary PLL tuning mode: only raw oscillator, no switches.
-    params.master_level = 1.0f;
-    params.fuzz_level = 1.0f;
-    params.osc_level = 0.5f;
-    params.sub_level = 1.0f;
-    params.trigger_ratio = 0.3f;
-    params.wave_shape = 1.0f;
-    params.sub_wave_shape = 1.0f;
-    params.main_pitch_multiplier = 2.0f;
-    params.sub_pitch_multiplier = 0.5f;
-    params.gate_enabled = true;
-    params.noise_mode = false;
-    params.envelope_follow = false;
-    params.sub_enabled = false;
-    params.deep_sub_mode = false;
-    params.raw_osc_only = false;
-    params.use_vco_phase_output = true;
-    params.vibrato_mode = false;
-    params.glide_speed = 0.25f;
-    pll.SetParams(params);
-
-    Settings persisted = loadSettings();
-    effect_enabled = (persisted.effect_enabled != 0);
-
     ControlState saved_state{};
     bool saved_state_valid = (persisted.preset_valid != 0);
     if (saved_state_valid)
@@ -251,15 +292,55 @@ int main()
     }
     ControlState pre_preset_state{};
 
+    ControlState derived_live_state{};
+    DerivedState live_derived{};
+    bool live_derived_valid = false;
+    DerivedState saved_derived = Derive(saved_state, base_params);
+    LinearRamp preset_morph{0.0f, 1000.0f / (preset_morph_ms * control_rate_hz)};
+
+    TuningMenu tuning_menu;
+
+    TapTempo tempo{500};
+    pll.SetLfoPeriodMs(tempo.Interval());
+    capture.LogLfoPeriod(tempo.Interval());
+
+    // Clearing the echo line and loading the cabinet take a while, so they
+    // run on the first control ticks instead of holding up the first audio.
+    size_t setup_step = 0;
+    auto set_up_wet_stages = [&]() {
+        if (setup_step++ == 0)
+        {
+            echo.Init(terrarium.seed.AudioSampleRate());
+            echo.SetFeedback(echo_feedback);
+            echo.SetDelayMs(tempo.Interval());
+            return;
+        }
+
+        // The cabinet response in the first flash slot, when there is one.
+        cabinet.Init(terrarium.seed.AudioSampleRate());
+        ImpulseResponse cabinet_response;
+        if (loadImpulseResponse(0, cabinet_response))
+        {
+            cabinet.SetImpulseResponse(cabinet_response.taps, cabinet_response.length, cabinet_response.sample_rate);
+            printf("Cabinet: %u taps\n", static_cast<unsigned>(cabinet.Taps()));
+        }
+        capture.LogCabinet(cabinet.Taps());
+        wet_stages_ready = true;
+    };
+
+    std::array<bool, Terrarium::stomp_count> stomp_down{};
+    std::array<uint32_t, Terrarium::stomp_count> stomp_down_ms{};
     bool preset_active = false;
     bool preset_hold_latched = false;
     bool preset_save_mode = false;
-    uint32_t preset_hold_samples = 0;
-    constexpr uint32_t long_press_samples = 200; // 1 second at 200 Hz loop.
+    constexpr uint32_t long_press_ms = 1000;
     constexpr uint32_t save_led_flash_ms = 160;
+    constexpr uint32_t capture_dump_hold_ms = 2000;
+    bool capture_dump_latched = false;
+    bool boot_time_reported = false;
 
     auto persist_state = [&]() {
-        persisted.version = 1;
+        persisted.version = Settings::current_version;
         persisted.preset_valid = saved_state_valid ? 1 : 0;
         persisted.effect_enabled = effect_enabled ? 1 : 0;
         if (saved_state_valid)
@@ -269,13 +350,27 @@ int main()
         saveSettings(terrarium.seed.qspi, persisted);
     };
 
-    terrarium.Loop(200, [&]() {
-        if (stomp_effect.RisingEdge())
+    terrarium.Loop(control_rate_hz, [&]() {
+        if (!wet_stages_ready)
         {
-            effect_enabled = !effect_enabled;
-            persist_state();
+            set_up_wet_stages();
+        }
+
+        if (!boot_time_reported && first_audio_us != 0)
+        {
+            // Time is measured from clock init in seed.Init().
+            boot_time_reported = true;
+            printf("Boot: first audio block after %lu us at %lu Hz%s\n",
+                static_cast<unsigned long>(first_audio_us),
+                static_cast<unsigned long>(terrarium.seed.AudioSampleRate()),
+                voice_modes[persisted.voice_mode]);
+            AudioWatchdog::PrintLog();
         }
 
+        const uint32_t now_ms = daisy::System::GetNow();
+        const uint32_t now_us = daisy::System::GetUs();
+        tempo.Update(now_ms);
+
         const ControlState live_state = ReadControlState(
             knob_osc_multiplier,
             knob_fuzz_level,
@@ -283,39 +378,74 @@ int main()
             knob_sub_multiplier,
             knob_sub_level,
             knob_master_level,
-            toggle_fuzz_on,
-            toggle_osc_on,
-            toggle_sub_on,
-            toggle_vibrato_mode);
+            terrarium.switch_events);
+
+        // In vibrato mode, short presses on footswitch 2 tap the LFO tempo.
+        const bool tap_mode = live_state.toggles[3];
 
-        // Footswitch 2: long hold enters save mode and snapshots current state.
-        if (stomp_preset.RisingEdge())
+        // Footswitch 1 toggles bypass from the audio callback; persist the
+        // result here.
+        if (effect_enabled != (persisted.effect_enabled != 0))
         {
-            preset_hold_samples = 0;
-            preset_hold_latched = false;
+            persist_state();
         }
 
-        if (stomp_preset.Pressed())
+        SwitchEvent event;
+        while (terrarium.switch_events.ControlEvents().Pop(event))
         {
-            ++preset_hold_samples;
-            if (!preset_hold_latched && preset_hold_samples >= long_press_samples)
+            if (event.source != SwitchEvent::Source::Stomp)
             {
-                preset_hold_latched = true;
-                preset_save_mode = true;
-                saved_state = live_state;
-                saved_state_valid = true;
-                persist_state();
+                continue;
+            }
+            capture.LogStomp(event.index, event.pressed);
+
+            // A release without a press is the end of a boot gesture.
+            const bool was_down = stomp_down[event.index];
+            stomp_down[event.index] = event.pressed;
+            if (!event.pressed && !was_down)
+            {
+                continue;
+            }
+
+            // Press times come from the interrupt, so holds and taps are
+            // measured from the actual edge.
+            const uint32_t event_ms = now_ms - ((now_us - event.time_us) / 1000);
+            if (event.pressed)
+            {
+                stomp_down_ms[event.index] = event_ms;
+            }
+
+            if (event.index == 0)
+            {
+                capture_dump_latched = false;
+                continue;
+            }
+
+            // Footswitch 2: long hold enters save mode and snapshots current state.
+            if (event.pressed)
+            {
+                preset_hold_latched = false;
+
+                if (tap_mode)
+                {
+                    tempo.Update(event_ms);
+                    tempo.Tap();
+                    tempo.Update(now_ms);
+                    pll.SetLfoPeriodMs(tempo.Interval());
+                    pll.SyncLfo();
+                    echo.SetDelayMs(tempo.Interval());
+                    capture.LogLfoPeriod(tempo.Interval());
+                    capture.LogLfoSync();
+                }
+                continue;
             }
-        }
 
-        if (stomp_preset.FallingEdge())
-        {
             if (preset_save_mode)
             {
                 // Releasing after a long hold exits save mode.
                 preset_save_mode = false;
             }
-            else if (!preset_hold_latched)
+            else if (!preset_hold_latched && !tap_mode)
             {
                 // Short press: toggle preset recall.
                 if (preset_active)
@@ -330,38 +460,100 @@ int main()
                         // If nothing has been saved yet, initialize from current state.
                         saved_state = live_state;
                         saved_state_valid = true;
+                        saved_derived = Derive(saved_state, base_params);
                         persist_state();
                     }
                     preset_active = true;
                 }
             }
-
-            preset_hold_samples = 0;
             preset_hold_latched = false;
         }
 
-        const ControlState& active_state = preset_active ? saved_state : live_state;
+        // Footswitch 1: long hold dumps the capture window on the console.
+        if (stomp_down[0] && !capture_dump_latched
+            && (now_ms - stomp_down_ms[0]) >= capture_dump_hold_ms)
+        {
+            capture_dump_latched = true;
+            capture.Dump();
+        }
+
+        if (stomp_down[1] && !preset_hold_latched
+            && (now_ms - stomp_down_ms[1]) >= long_press_ms)
+        {
+            preset_hold_latched = true;
+            preset_save_mode = true;
+            saved_state = live_state;
+            saved_state_valid = true;
+            saved_derived = Derive(saved_state, base_params);
+            persist_state();
+        }
+
         (void)pre_preset_state;
-        ApplyControlState(active_state, params);
+
+        // Tuning changes apply straight away to both preset endpoints.
+        if (terrarium.EncoderReady()
+            && tuning_menu.Process(terrarium.encoder.Increment(), terrarium.encoder.RisingEdge(), persisted.tuning))
+        {
+            ApplyTuning(persisted.tuning, base_params);
+            capture.LogTuning(persisted.tuning);
+            live_derived_valid = false;
+            saved_derived = Derive(saved_state, base_params);
+        }
+        if (tuning_menu.TakeSaveRequest())
+        {
+            persist_state();
+        }
+
+        // Endpoints are only re-derived when their controls actually change.
+        if (!live_derived_valid || ControlStateChanged(live_state, derived_live_state))
+        {
+            derived_live_state = live_state;
+            live_derived = Derive(live_state, base_params);
+            live_derived_valid = true;
+            capture.LogLiveState(live_state);
+        }
+
+        // Preset recall glides between the live and stored endpoints.
+        const float morph = preset_morph(preset_active ? 1.0f : 0.0f);
+        const DerivedState active = blended(live_derived, saved_derived, morph);
+        capture.LogMorph(morph);
+        capture.LogSavedState(saved_state);
+        capture.Process();
+        params = active.params;
+        output_master_level = active.output_level;
 
         // Active controls in simplified PLL mode:
-        // - knob 1: main oscillator pitch multiplier (categorical)
+        // - knob 1: main oscillator pitch multiplier (categorical); in the
+        //   harmony voice mode repeated multipliers add harmony voices
         // - knob 2: fuzz level
-        // - knob 3: glide speed (0 slow -> 1 instant snap)
-        // - knob 4: sub oscillator interval selector (categorical)
+        // - knob 3: glide speed (50% slow -> 100% instant snap); below 50%
+        //   the noise voice fades in toward 0, or in tempo mode the LFO
+        //   wah and tremolo deepen toward 0
+        // - knob 4: sub oscillator interval selector (categorical); repeated
+        //   octaves switch to the flip-flop divider
         // - knob 5: sub oscillator level
         // - knob 6: master level
         // Switches:
         // - switch 1: fuzz on/off
         // - switch 2: oscillator on/off
         // - switch 3: sub oscillator on/off
-        // - switch 4: osc-fx bypass (raw wave)
+        // - switch 4: tempo mode (echo, footswitch 2 taps tempo; raw wave +
+        //   vibrato, or the osc effects + LFO wah and tremolo with knob 3 low)
         // Footswitch 2:
         // - hold >1s: save current knob/switch state (LED2 flashes while held)
-        // - short press: toggle preset recall on/off
-        // Stability fixed to midpoint (50%).
+        // - short press: glide preset recall on/off over preset_morph_ms
+        // Encoder and display: tuning menu (turn to pick, click to edit/store)
 
         pll.SetParams(params);
+        echo.SetLevel(tap_mode ? echo_level : 0.0f);
+        capture.LogEcho(tap_mode ? echo_level : 0.0f, echo_feedback);
+        watchdog.SetConfig(params);
+        watchdog.Process(terrarium.seed.qspi, daisy::System::GetNow());
+
+        if (terrarium.DisplayReady())
+        {
+            tuning_menu.Draw(terrarium.display, persisted.tuning);
+        }
 
         led_effect.Set(effect_enabled ? 1.0f : 0.0f);
 
@@ -370,9 +562,17 @@ int main()
             const bool flash_on = ((daisy::System::GetNow() / save_led_flash_ms) % 2) == 0;
             led_preset.Set(flash_on ? 1.0f : 0.0f);
         }
+        else if (tap_mode)
+        {
+            led_preset.Set(tempo.Ratio() < 0.25f ? 1.0f : 0.0f);
+        }
         else
         {
             led_preset.Set(preset_active ? 1.0f : 0.0f);
         }
+    },
+    []() {
+        // Between ticks, so notes leave as soon as they are queued.
+        midi_out.Send();
     });
 }
@@ -0,0 +1,234 @@
+#include "AudioWatchdog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <daisy_seed.h>
+
+#include <util/PersistentSettings.h>
+
+namespace
+{
+
+// Catch-all for configurations once the table is full.
+constexpr uint32_t other_config_key = 0xFFFFFFFF;
+
+void PrintConfig(uint32_t key)
+{
+    if (key == other_config_key)
+    {
+        printf("other");
+        return;
+    }
+    const auto field = [key](int shift, uint32_t mask) {
+        return static_cast<unsigned long>((key >> shift) & mask);
+    };
+    printf("fuzz=%lu osc=%lu sub=%lu vib=%lu noise=%lu ff=%lu harm=%lu main=%lu/2 sub=%lu/24 poly=%lu resynth=%lu",
+        field(0, 1), field(1, 1), field(2, 1), field(3, 1),
+        field(4, 1), field(5, 1), field(6, 7), field(9, 31), field(14, 31), field(19, 1),
+        field(20, 1));
+}
+
+} // namespace
+
+void AudioWatchdog::Init(float sample_rate, size_t block_size)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+    const float block_cycles = SystemCoreClock * (static_cast<float>(block_size) / sample_rate);
+    _budget_cycles = static_cast<uint32_t>(block_cycles);
+    _near_miss_cycles = static_cast<uint32_t>(block_cycles * near_miss_ratio);
+    _late_start_cycles = static_cast<uint32_t>(block_cycles * late_start_ratio);
+
+    _slots[0].key = other_config_key;
+    _slot_count = 1;
+
+    OverrunRecord record{};
+    for (size_t i = 0; i < overrunRecordCount(); ++i)
+    {
+        if (loadOverrunRecord(i, record))
+        {
+            _session = std::max(_session, record.session);
+        }
+    }
+    ++_session;
+}
+
+void AudioWatchdog::Count(Counters& slot, Cause cause)
+{
+    slot.counts[cause] = slot.counts[cause] + 1;
+}
+
+void AudioWatchdog::BeginBlock()
+{
+    const uint32_t now = DWT->CYCCNT;
+    if (_started && (now - _block_start) > _late_start_cycles)
+    {
+        Count(_slots[_current], LateStart);
+    }
+    _block_start = now;
+    _started = true;
+}
+
+void AudioWatchdog::EndBlock()
+{
+    const uint32_t elapsed = DWT->CYCCNT - _block_start;
+    auto& slot = _slots[_current];
+    if (elapsed > _budget_cycles)
+    {
+        Count(slot, Overrun);
+    }
+    else if (elapsed > _near_miss_cycles)
+    {
+        Count(slot, NearMiss);
+    }
+    if (elapsed > slot.worst_cycles)
+    {
+        slot.worst_cycles = elapsed;
+    }
+}
+
+uint32_t AudioWatchdog::ConfigKey(const PLL::Params& params)
+{
+    const auto bit = [](bool on, int shift) { return (on ? 1u : 0u) << shift; };
+    const auto main_halves = static_cast<uint32_t>(std::lround(params.main_pitch_multiplier * 2.0f));
+    const auto sub_24ths = static_cast<uint32_t>(std::lround(params.sub_pitch_multiplier * 24.0f));
+    return bit(params.fuzz_level > 0.0f, 0)
+        | bit(params.osc_level > 0.0f, 1)
+        | bit(params.sub_enabled, 2)
+        | bit(params.vibrato_mode, 3)
+        | bit(params.noise_mode, 4)
+        | bit(params.flip_flop_divider, 5)
+        | (std::min<uint32_t>(params.harmony_voice_count, 7) << 6)
+        | (std::min<uint32_t>(main_halves, 31) << 9)
+        | (std::min<uint32_t>(sub_24ths, 31) << 14)
+        | bit(params.poly_tracking, 19)
+        | bit(params.resynthesis, 20);
+}
+
+void AudioWatchdog::SetConfig(const PLL::Params& params)
+{
+    const uint32_t key = ConfigKey(params);
+    if (_slots[_current].key == key)
+    {
+        return;
+    }
+
+    for (size_t i = 1; i < _slot_count; ++i)
+    {
+        if (_slots[i].key == key)
+        {
+            _current = i;
+            return;
+        }
+    }
+
+    if (_slot_count < config_slots)
+    {
+        _slots[_slot_count].key = key;
+        _current = _slot_count++;
+    }
+    else
+    {
+        _current = 0;
+    }
+}
+
+void AudioWatchdog::Process(daisy::QSPIHandle& qspi, uint32_t now_ms)
+{
+    if ((now_ms - _last_flush_ms) >= flush_interval_ms)
+    {
+        _last_flush_ms = now_ms;
+        Flush(qspi, now_ms);
+    }
+}
+
+void AudioWatchdog::Flush(daisy::QSPIHandle& qspi, uint32_t now_ms)
+{
+    // Only configurations with new misses cost a flash write.
+    for (size_t i = 0; i < _slot_count; ++i)
+    {
+        auto& slot = _slots[i];
+        std::array<uint32_t, cause_count> counts;
+        bool changed = false;
+        for (size_t c = 0; c < cause_count; ++c)
+        {
+            counts[c] = slot.counts[c];
+            changed |= (counts[c] != slot.flushed[c]);
+        }
+        if (!changed)
+        {
+            continue;
+        }
+
+        OverrunRecord record{};
+        record.session = _session;
+        record.uptime_s = now_ms / 1000;
+        record.config_key = slot.key;
+        record.budget_cycles = _budget_cycles;
+        record.worst_cycles = slot.worst_cycles;
+        record.overruns = counts[Overrun] - slot.flushed[Overrun];
+        record.near_misses = counts[NearMiss] - slot.flushed[NearMiss];
+        record.late_starts = counts[LateStart] - slot.flushed[LateStart];
+        appendOverrunRecord(qspi, record);
+        slot.flushed = counts;
+    }
+}
+
+void AudioWatchdog::PrintLog()
+{
+    struct Total
+    {
+        uint32_t key;
+        uint32_t overruns;
+        uint32_t near_misses;
+        uint32_t late_starts;
+        uint32_t worst_cycles;
+        uint32_t budget_cycles;
+    };
+    std::array<Total, 32> totals{};
+    size_t total_count = 0;
+
+    const size_t record_count = overrunRecordCount();
+    OverrunRecord record{};
+    for (size_t i = 0; i < record_count; ++i)
+    {
+        if (!loadOverrunRecord(i, record))
+        {
+            continue;
+        }
+
+        auto total = std::find_if(totals.begin(), totals.begin() + total_count,
+            [&](const Total& t) { return t.key == record.config_key; });
+        if (total == totals.begin() + total_count)
+        {
+            if (total_count == totals.size())
+            {
+                continue;
+            }
+            *total = Total{record.config_key, 0, 0, 0, 0, record.budget_cycles};
+            ++total_count;
+        }
+        total->overruns += record.overruns;
+        total->near_misses += record.near_misses;
+        total->late_starts += record.late_starts;
+        total->worst_cycles = std::max(total->worst_cycles, record.worst_cycles);
+    }
+
+    printf("Overrun log: %lu records\n", static_cast<unsigned long>(record_count));
+    for (size_t i = 0; i < total_count; ++i)
+    {
+        const auto& t = totals[i];
+        printf("  overruns=%lu near=%lu late=%lu worst=%lu/%lu cycles ",
+            static_cast<unsigned long>(t.overruns),
+            static_cast<unsigned long>(t.near_misses),
+            static_cast<unsigned long>(t.late_starts),
+            static_cast<unsigned long>(t.worst_cycles),
+            static_cast<unsigned long>(t.budget_cycles));
+        PrintConfig(t.key);
+        printf("\n");
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <per/qspi.h>
+
+#include <util/PLL.h>
+
+// Audio deadline monitor.
+//
+// Times every audio callback with the core cycle counter and counts blocks
+// that overrun the block period, come close to it, or start late. Counts are
+// kept per PLL configuration, and summaries of new counts are appended to a
+// flash log so configurations that push the CPU over can be found after the
+// fact.
+class AudioWatchdog
+{
+public:
+    enum Cause
+    {
+        Overrun,   // callback took longer than the block period
+        NearMiss,  // callback used more than near_miss_ratio of it
+        LateStart, // callback started well after its period
+        cause_count
+    };
+
+    static constexpr float near_miss_ratio = 0.8f;
+    static constexpr float late_start_ratio = 1.5f;
+    static constexpr uint32_t flush_interval_ms = 60000;
+
+    void Init(float sample_rate, size_t block_size);
+
+    // Audio callback side, first and last thing in the callback.
+    void BeginBlock();
+    void EndBlock();
+
+    // Control loop side.
+    void SetConfig(const PLL::Params& params);
+    void Process(daisy::QSPIHandle& qspi, uint32_t now_ms);
+
+    // Prints the flash log on the console, summed per configuration.
+    static void PrintLog();
+
+    static uint32_t ConfigKey(const PLL::Params& params);
+
+private:
+    static constexpr size_t config_slots = 16;
+
+    struct Counters
+    {
+        uint32_t key = 0;
+        std::array<volatile uint32_t, cause_count> counts{};
+        volatile uint32_t worst_cycles = 0;
+        std::array<uint32_t, cause_count> flushed{};
+    };
+
+    static void Count(Counters& slot, Cause cause);
+    void Flush(daisy::QSPIHandle& qspi, uint32_t now_ms);
+
+    std::array<Counters, config_slots> _slots{};
+    size_t _slot_count = 0;
+    volatile size_t _current = 0;
+
+    uint32_t _budget_cycles = 0;
+    uint32_t _near_miss_cycles = 0;
+    uint32_t _late_start_cycles = 0;
+    uint32_t _block_start = 0;
+    bool _started = false;
+    uint32_t _last_flush_ms = 0;
+    uint16_t _session = 0;
+};
@@ -0,0 +1,280 @@
+#include "Capture.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include <daisy_seed.h>
+
+namespace
+{
+
+float DSY_SDRAM_BSS audio_ring[Capture::audio_capacity];
+Capture::Event DSY_SDRAM_BSS event_ring[Capture::event_capacity];
+
+// Values are dumped as raw bits so a replay sees exactly the same floats.
+unsigned long FloatBits(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+constexpr size_t audio_values_per_line = 16;
+
+} // namespace
+
+void Capture::Init(float sample_rate, size_t block_size)
+{
+    _sample_rate = static_cast<uint32_t>(sample_rate);
+    _block_size = static_cast<uint32_t>(block_size);
+}
+
+void Capture::RecordInput(const float* in, size_t size)
+{
+    uint32_t clock = _clock;
+    if (!_frozen)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            audio_ring[(clock + i) % audio_capacity] = in[i];
+        }
+    }
+    _clock = clock + static_cast<uint32_t>(size);
+}
+
+void Capture::Log(EventType type, uint8_t index, uint16_t bits, float value)
+{
+    // The ring is being printed; the next keyframe restores the state.
+    if (_frozen)
+    {
+        return;
+    }
+    event_ring[_event_count % event_capacity] = Event{_clock, type, index, bits, value};
+    ++_event_count;
+}
+
+uint16_t Capture::ToggleBits(const ControlState& state)
+{
+    uint16_t bits = 0;
+    for (size_t i = 0; i < state.toggles.size(); ++i)
+    {
+        bits |= state.toggles[i] ? (1u << i) : 0u;
+    }
+    return bits;
+}
+
+void Capture::LogState(const ControlState& state, ControlState& logged, bool saved, bool force)
+{
+    const auto knob_type = saved ? EventType::SavedKnob : EventType::LiveKnob;
+    const auto toggle_type = saved ? EventType::SavedToggles : EventType::LiveToggles;
+
+    for (size_t i = 0; i < state.knobs.size(); ++i)
+    {
+        if (force || state.knobs[i] != logged.knobs[i])
+        {
+            Log(knob_type, static_cast<uint8_t>(i), 0, state.knobs[i]);
+        }
+    }
+    if (force || state.toggles != logged.toggles)
+    {
+        Log(toggle_type, 0, ToggleBits(state), 0.0f);
+    }
+    logged = state;
+}
+
+void Capture::LogLiveState(const ControlState& state)
+{
+    LogState(state, _live, false, false);
+}
+
+void Capture::LogSavedState(const ControlState& state)
+{
+    LogState(state, _saved, true, false);
+}
+
+void Capture::LogMorph(float position)
+{
+    if (position != _morph)
+    {
+        _morph = position;
+        Log(EventType::Morph, 0, 0, position);
+    }
+}
+
+void Capture::LogBypass(bool enabled, uint32_t sample)
+{
+    _audio_events.Push(Event{sample, EventType::Bypass, 0, static_cast<uint16_t>(enabled ? 1 : 0), 0.0f});
+}
+
+void Capture::LogStomp(int index, bool rising)
+{
+    Log(rising ? EventType::StompRise : EventType::StompFall, static_cast<uint8_t>(index), 0, 0.0f);
+}
+
+void Capture::LogLfoPeriod(uint32_t period_ms)
+{
+    if (period_ms != _lfo_period_ms)
+    {
+        _lfo_period_ms = period_ms;
+        Log(EventType::LfoPeriod, 0, 0, static_cast<float>(period_ms));
+    }
+}
+
+void Capture::LogLfoSync()
+{
+    Log(EventType::LfoSync, 0, 0, 0.0f);
+}
+
+void Capture::LogEcho(float level, float feedback)
+{
+    if (level != _echo_level)
+    {
+        _echo_level = level;
+        Log(EventType::EchoLevel, 0, 0, level);
+    }
+    if (feedback != _echo_feedback)
+    {
+        _echo_feedback = feedback;
+        Log(EventType::EchoFeedback, 0, 0, feedback);
+    }
+}
+
+void Capture::LogVoiceMode(uint8_t mode)
+{
+    if (mode != _voice_mode)
+    {
+        _voice_mode = mode;
+        Log(EventType::VoiceMode, 0, mode, 0.0f);
+    }
+}
+
+void Capture::LogTuning(const Tuning& tuning)
+{
+    for (size_t i = 0; i < tuning_fields; ++i)
+    {
+        const float value = TuningField(tuning, i);
+        if (value != TuningField(_tuning, i))
+        {
+            Log(EventType::TuningField, static_cast<uint8_t>(i), 0, value);
+        }
+    }
+    _tuning = tuning;
+}
+
+void Capture::LogCabinet(size_t taps)
+{
+    if (taps != _cabinet_taps)
+    {
+        _cabinet_taps = static_cast<uint32_t>(taps);
+        Log(EventType::CabinetTaps, 0, 0, static_cast<float>(taps));
+    }
+}
+
+void Capture::LogKeyframe()
+{
+    Log(EventType::Keyframe, 0, 0, 0.0f);
+    LogState(_live, _live, false, true);
+    LogState(_saved, _saved, true, true);
+    Log(EventType::Morph, 0, 0, _morph);
+    Log(EventType::Bypass, 0, _bypass_enabled ? 1 : 0, 0.0f);
+    Log(EventType::LfoPeriod, 0, 0, static_cast<float>(_lfo_period_ms));
+    Log(EventType::EchoLevel, 0, 0, _echo_level);
+    Log(EventType::EchoFeedback, 0, 0, _echo_feedback);
+    Log(EventType::VoiceMode, 0, _voice_mode, 0.0f);
+    for (size_t i = 0; i < tuning_fields; ++i)
+    {
+        Log(EventType::TuningField, static_cast<uint8_t>(i), 0, TuningField(_tuning, i));
+    }
+    Log(EventType::CabinetTaps, 0, 0, static_cast<float>(_cabinet_taps));
+    _last_keyframe = _clock;
+    _keyframe_pending = false;
+}
+
+void Capture::TakeAudioEvents()
+{
+    Event event;
+    while (_audio_events.Pop(event))
+    {
+        _bypass_enabled = (event.bits != 0);
+        if (!_frozen)
+        {
+            event_ring[_event_count % event_capacity] = event;
+            ++_event_count;
+        }
+    }
+}
+
+void Capture::Process()
+{
+    TakeAudioEvents();
+    if (_dumping)
+    {
+        DumpLines();
+        return;
+    }
+    if (_keyframe_pending || (_clock - _last_keyframe) >= _sample_rate)
+    {
+        LogKeyframe();
+    }
+}
+
+void Capture::Dump()
+{
+    if (_dumping)
+    {
+        return;
+    }
+
+    _frozen = true;
+    _dumping = true;
+    _dump_end = _clock;
+    const uint32_t oldest = (_dump_end > audio_capacity) ? (_dump_end - audio_capacity) : 0;
+    _dump_sample = std::max(oldest, _audio_valid_from);
+    _dump_event_end = _event_count;
+    _dump_event = _event_count - std::min(_event_count, event_capacity);
+
+    printf("CAPTURE 2 rate=%lu block=%lu start=%lu end=%lu\n",
+        static_cast<unsigned long>(_sample_rate),
+        static_cast<unsigned long>(_block_size),
+        static_cast<unsigned long>(_dump_sample),
+        static_cast<unsigned long>(_dump_end));
+}
+
+void Capture::DumpLines()
+{
+    for (size_t line = 0; line < dump_lines_per_tick; ++line)
+    {
+        if (_dump_event < _dump_event_end)
+        {
+            const auto& event = event_ring[_dump_event++ % event_capacity];
+            printf("E %lu %u %u %u %08lx\n",
+                static_cast<unsigned long>(event.sample),
+                static_cast<unsigned>(event.type),
+                static_cast<unsigned>(event.index),
+                static_cast<unsigned>(event.bits),
+                FloatBits(event.value));
+        }
+        else if (_dump_sample < _dump_end)
+        {
+            printf("A %lu", static_cast<unsigned long>(_dump_sample));
+            const uint32_t line_end = std::min<uint32_t>(_dump_end, _dump_sample + audio_values_per_line);
+            for (; _dump_sample < line_end; ++_dump_sample)
+            {
+                printf(" %08lx", FloatBits(audio_ring[_dump_sample % audio_capacity]));
+            }
+            printf("\n");
+        }
+        else
+        {
+            printf("END\n");
+
+            // Samples that arrived during the dump were not recorded.
+            _audio_valid_from = _clock;
+            _keyframe_pending = true;
+            _dumping = false;
+            _frozen = false;
+            return;
+        }
+    }
+}
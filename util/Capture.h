@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <util/Controls.h>
+#include <util/EventQueue.h>
+#include <util/Tuning.h>
+
+// Flight recorder for reproducing glitches.
+//
+// Keeps the last few seconds of input audio and a log of every control
+// change, both stamped with the audio sample clock. Dump() prints them on
+// the console; host/Replay feeds the same sequence back through
+// ApplyControlState, PLL, Echo and the cabinet.
+//
+// RecordInput() and LogBypass() run in the audio callback; everything else
+// belongs to the control loop.
+class Capture
+{
+public:
+    enum class EventType : uint8_t
+    {
+        Keyframe,
+        LiveKnob,
+        LiveToggles,
+        SavedKnob,
+        SavedToggles,
+        Morph,
+        Bypass,
+        StompRise,
+        StompFall,
+        LfoPeriod,
+        LfoSync,
+        EchoLevel,
+        EchoFeedback,
+        VoiceMode,
+        TuningField,
+        CabinetTaps,
+    };
+
+    struct Event
+    {
+        uint32_t sample;
+        EventType type;
+        uint8_t index;
+        uint16_t bits;
+        float value;
+    };
+
+    // Both rings live in SDRAM: 8 s of input at 48 kHz and the events
+    // around it.
+    static constexpr size_t audio_capacity = 8 * 48000;
+    static constexpr size_t event_capacity = 8192;
+
+    // The tuning is logged a field at a time, by index.
+    static constexpr size_t tuning_fields = sizeof(Tuning) / sizeof(float);
+    static_assert(sizeof(Tuning) == tuning_fields * sizeof(float), "Tuning must be all floats");
+
+    static float TuningField(const Tuning& tuning, size_t index)
+    {
+        float value;
+        std::memcpy(&value, reinterpret_cast<const uint8_t*>(&tuning) + (index * sizeof(float)), sizeof(value));
+        return value;
+    }
+
+    static void SetTuningField(Tuning& tuning, size_t index, float value)
+    {
+        std::memcpy(reinterpret_cast<uint8_t*>(&tuning) + (index * sizeof(float)), &value, sizeof(value));
+    }
+
+    void Init(float sample_rate, size_t block_size);
+
+    void RecordInput(const float* in, size_t size);
+
+    uint32_t Now() const { return _clock; }
+
+    // Each logger only records what changed since the last call.
+    void LogLiveState(const ControlState& state);
+    void LogSavedState(const ControlState& state);
+    void LogMorph(float position);
+    void LogStomp(int index, bool rising);
+    void LogLfoPeriod(uint32_t period_ms);
+    void LogLfoSync();
+    void LogEcho(float level, float feedback);
+    void LogVoiceMode(uint8_t mode);
+    void LogTuning(const Tuning& tuning);
+    // Taps of the loaded cabinet response, which is too long to log; a
+    // replay has to be given the same one.
+    void LogCabinet(size_t taps);
+
+    // Bypass switches in the audio callback, so it is logged from there at
+    // the sample it took effect; Process() moves it into the event log.
+    void LogBypass(bool enabled, uint32_t sample);
+
+    // Call once per control tick. Writes a full state snapshot every second
+    // so a replay can start anywhere inside the audio window, and carries
+    // on with a dump in progress.
+    void Process();
+
+    // Starts printing the capture window on the console, dump_lines_per_tick
+    // lines per Process() so no control tick waits long on the console.
+    // Recording pauses until the dump is done.
+    void Dump();
+    bool Dumping() const { return _dumping; }
+
+    static constexpr size_t dump_lines_per_tick = 8;
+
+private:
+    void Log(EventType type, uint8_t index, uint16_t bits, float value);
+    void LogState(const ControlState& state, ControlState& logged, bool saved, bool force);
+    void LogKeyframe();
+    void TakeAudioEvents();
+    void DumpLines();
+
+    static uint16_t ToggleBits(const ControlState& state);
+
+    volatile uint32_t _clock = 0;
+    volatile bool _frozen = false;
+    uint32_t _audio_valid_from = 0;
+    uint32_t _sample_rate = 48000;
+    uint32_t _block_size = 2;
+    uint32_t _last_keyframe = 0;
+    bool _keyframe_pending = true;
+    size_t _event_count = 0;
+
+    ControlState _live{};
+    ControlState _saved{};
+    float _morph = 0.0f;
+    bool _bypass_enabled = true;
+    uint32_t _lfo_period_ms = 0;
+    float _echo_level = 0.0f;
+    float _echo_feedback = 0.0f;
+    uint8_t _voice_mode = 0;
+    Tuning _tuning{};
+    uint32_t _cabinet_taps = 0;
+    EventQueue<Event, 16> _audio_events;
+
+    bool _dumping = false;
+    size_t _dump_event = 0;
+    size_t _dump_event_end = 0;
+    uint32_t _dump_sample = 0;
+    uint32_t _dump_end = 0;
+};
@@ -0,0 +1,224 @@
+#include "Controls.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <util/Mapping.h>
+
+namespace
+{
+
+constexpr LinearMapping fuzz_level_mapping{0.0f, 2.0f};
+constexpr LinearMapping master_level_mapping{0.0f, 1.5f};
+constexpr float vibrato_depth = 0.03f;
+constexpr float max_lfo_wah_depth = 0.8f;
+constexpr float max_tremolo_depth = 0.7f;
+constexpr float max_noise_level = 1.0f;
+constexpr float harmony_level = 0.8f;
+// Knob movement below this is treated as ADC noise, not a control change.
+constexpr float knob_change_threshold = 0.002f;
+
+float QuantizedPitchMultiplier(float knob_ratio)
+{
+    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
+    const int bucket = static_cast<int>(clamped * 10.0f);
+
+    switch (bucket)
+    {
+        case 0: return 1.0f; // 0-10%
+        case 1: return 2.0f; // 10-20%
+        case 2: return 2.0f;
+        case 3: return 2.5f;
+        case 4: return 3.0f;
+        case 5: return 3.0f;
+        case 6: return 3.5f;
+        default: return 4.0f; // up to +2 octaves
+    }
+}
+
+struct Harmony
+{
+    int voices;
+    std::array<float, 3> ratios;
+};
+
+// The second of two pitch knob positions with the same multiplier adds
+// harmony voices over the main one. Ratios are to the fundamental.
+Harmony QuantizedHarmony(float knob_ratio)
+{
+    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
+    const int bucket = static_cast<int>(clamped * 10.0f);
+
+    switch (bucket)
+    {
+        case 2: return {1, {3.0f}};             // x2 and its fifth
+        case 5: return {2, {3.75f, 4.5f}};      // x3 and its major triad
+        case 9: return {3, {2.0f, 5.0f, 6.0f}}; // x4, its triad and octave below
+        default: return {0, {}};
+    }
+}
+
+float QuantizedSubIntervalMultiplier(float knob_ratio)
+{
+    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
+    const int bucket = static_cast<int>(clamped * 10.0f);
+
+    // Categorical intervals below the main oscillator.
+    // Includes musical intervals: perfect fourth below (x0.75) and
+    // perfect fifth below (x2/3), plus octave divisions.
+    switch (bucket)
+    {
+        case 0:
+        case 1: return 0.75f;                // perfect fourth below
+        case 2:
+        case 3: return 2.0f / 3.0f;          // perfect fifth below
+        case 4:
+        case 5: return 0.5f;                 // -1 octave
+        case 6: return 1.0f / 3.0f;          // octave + fifth below
+        case 7:
+        case 8: return 0.25f;                // -2 octaves
+        default: return 0.125f;              // -3 octaves
+    }
+}
+
+// Likewise the second octave-down sub position switches to the flip-flop
+// divider sound.
+bool QuantizedSubDivider(float knob_ratio)
+{
+    const float clamped = std::clamp(knob_ratio, 0.0f, 0.9999f);
+    const int bucket = static_cast<int>(clamped * 10.0f);
+    return bucket == 5 || bucket == 8;
+}
+
+} // namespace
+
+DerivedState blended(const DerivedState& d1, const DerivedState& d2, float ratio)
+{
+    DerivedState d{};
+    d.params = blended(d1.params, d2.params, ratio);
+    d.output_level = std::lerp(d1.output_level, d2.output_level, ratio);
+    return d;
+}
+
+bool ControlStateChanged(const ControlState& a, const ControlState& b)
+{
+    for (size_t i = 0; i < a.knobs.size(); ++i)
+    {
+        if (std::abs(a.knobs[i] - b.knobs[i]) > knob_change_threshold)
+        {
+            return true;
+        }
+    }
+    return a.toggles != b.toggles;
+}
+
+void ApplyControlState(const ControlState& state, PLL::Params& params, float& output_level)
+{
+    params.raw_osc_only = false;
+    params.gate_enabled = true;
+    params.envelope_follow = false;
+
+    // Switch 1: fuzz on/off, knob 2 sets fuzz level.
+    params.fuzz_level = state.toggles[0]
+        ? fuzz_level_mapping(state.knobs[1])
+        : 0.0f;
+    // Switch 2: oscillator on/off.
+    params.osc_level = state.toggles[1] ? 0.5f : 0.0f;
+    // Switch 3: sub oscillator on/off.
+    params.sub_enabled = state.toggles[2];
+    params.sub_level = params.sub_enabled ? state.knobs[4] : 0.0f;
+
+    // Knob 6 controls overall output level at the final output stage.
+    output_level = master_level_mapping(state.knobs[5]);
+    params.master_level = 1.0f;
+
+    // Trigger ratio, wave shapes and the loop gains are left to the base
+    // parameters, which carry the tuning menu's values.
+
+    // Knob 1 and 4 are categorical pitch multiplier controls.
+    params.main_pitch_multiplier = QuantizedPitchMultiplier(state.knobs[0]);
+    params.sub_pitch_multiplier = QuantizedSubIntervalMultiplier(state.knobs[3]);
+    params.flip_flop_divider = QuantizedSubDivider(state.knobs[3]);
+
+    const auto harmony = params.harmony_mode ? QuantizedHarmony(state.knobs[0]) : Harmony{};
+    params.harmony_voice_count = harmony.voices;
+    params.harmony_level = (harmony.voices > 0) ? harmony_level : 0.0f;
+    std::copy(harmony.ratios.begin(), harmony.ratios.end(), params.harmony_ratios.begin());
+
+    // Compress glide control into upper half of the knob so 50% now
+    // matches the previous slowest setting and the rest sweeps faster.
+    const float glide_shifted = std::clamp((state.knobs[2] - 0.5f) * 2.0f, 0.0f, 1.0f);
+    params.glide_speed = (state.knobs[2] > 0.97f) ? 1.0f : std::pow(glide_shifted, 3.0f);
+
+    // The lower half, where the glide stays at its slowest, is a depth
+    // control of its own: the noise voice, or the tempo LFO under switch 4.
+    const float glide_low_half = std::clamp((0.5f - state.knobs[2]) * 2.0f, 0.0f, 1.0f);
+    const bool tempo_mode = state.toggles[3];
+
+    // Switch 4: tempo mode. Raw oscillator voice with tempo-synced vibrato,
+    // or with the knob in its lower half the oscillator effects stay on and
+    // the LFO sweeps the cross wah and pulses the voice levels instead.
+    const bool tempo_fx = tempo_mode && (glide_low_half > 0.0f);
+    params.vibrato_mode = tempo_mode && !tempo_fx;
+    params.lfo_pitch_depth = params.vibrato_mode ? vibrato_depth : 0.0f;
+    params.lfo_wah_depth = tempo_fx ? (glide_low_half * max_lfo_wah_depth) : 0.0f;
+    params.lfo_level_depth = tempo_fx ? (glide_low_half * max_tremolo_depth) : 0.0f;
+
+    params.noise_mode = !tempo_mode && (glide_low_half > 0.0f);
+    params.noise_level = params.noise_mode ? (glide_low_half * max_noise_level) : 0.0f;
+}
+
+DerivedState Derive(const ControlState& state, const PLL::Params& base)
+{
+    DerivedState derived{};
+    derived.params = base;
+    ApplyControlState(state, derived.params, derived.output_level);
+    return derived;
+}
+
+PLL::Params DefaultParams()
+{
+    // Temporary PLL tuning mode: only raw oscillator, no switches.
+    PLL::Params params{};
+    params.master_level = 1.0f;
+    params.fuzz_level = 1.0f;
+    params.osc_level = 0.5f;
+    params.sub_level = 1.0f;
+    params.trigger_ratio = 0.3f;
+    params.wave_shape = 1.0f;
+    params.sub_wave_shape = 1.0f;
+    params.main_pitch_multiplier = 2.0f;
+    params.sub_pitch_multiplier = 0.5f;
+    params.gate_enabled = true;
+    params.envelope_follow = false;
+    params.sub_enabled = false;
+    params.deep_sub_mode = false;
+    params.raw_osc_only = false;
+    params.use_vco_phase_output = true;
+    params.vibrato_mode = false;
+    params.glide_speed = 0.25f;
+    return params;
+}
+
+void ApplyVoiceMode(uint8_t mode, PLL::Params& params)
+{
+    params.poly_tracking = (mode == 1);
+    params.resynthesis = (mode == 2);
+    params.harmony_mode = (mode == 3);
+}
+
+void ApplyTuning(const Tuning& tuning, PLL::Params& params)
+{
+    LoopDesign loop{};
+    loop.natural_hz = tuning.loop_natural_hz;
+    loop.damping = tuning.loop_damping;
+    loop.lock_range_hz = tuning.loop_lock_range_hz;
+    params.SetLoop(loop);
+    params.fll_gain = tuning.fll_gain;
+    params.trigger_ratio = tuning.trigger_ratio;
+    params.wave_shape = tuning.wave_shape;
+    params.sub_wave_shape = tuning.sub_wave_shape;
+    params.wah_tracking_ratio = tuning.wah_tracking_ratio;
+    params.wah_q_max = tuning.wah_q_max;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <util/PLL.h>
+#include <util/Tuning.h>
+
+// Applied to the wet signal after the master level.
+constexpr float final_output_trim = 0.2f;
+
+// Dry/wet crossfade when the effect is switched in or out.
+constexpr float bypass_crossfade_ms = 10.0f;
+
+// Knob and switch positions, independent of the hardware that read them.
+struct ControlState
+{
+    std::array<float, 6> knobs{};
+    std::array<bool, 4> toggles{};
+};
+
+// Everything derived from a ControlState. Preset morphs interpolate between
+// two of these, so the control mappings only run when an endpoint changes.
+struct DerivedState
+{
+    PLL::Params params{};
+    float output_level = 0.0f;
+};
+
+DerivedState blended(const DerivedState& d1, const DerivedState& d2, float ratio);
+
+// True when the states differ by more than ADC noise.
+bool ControlStateChanged(const ControlState& a, const ControlState& b);
+
+// Maps the panel controls onto PLL parameters and the output level.
+void ApplyControlState(const ControlState& state, PLL::Params& params, float& output_level);
+
+// ApplyControlState() on top of a copy of base.
+DerivedState Derive(const ControlState& state, const PLL::Params& base);
+
+// PLL parameters the controls are applied on top of.
+PLL::Params DefaultParams();
+
+// Main voice modes, as stored in Settings::voice_mode: 0 = wave shapes,
+// 1 = chord tracking, 2 = harmonic resynthesis, 3 = wave shapes with the
+// harmony voices on the pitch knob.
+constexpr uint8_t voice_mode_count = 4;
+void ApplyVoiceMode(uint8_t mode, PLL::Params& params);
+
+// Overrides the menu-tunable parameters in params.
+void ApplyTuning(const Tuning& tuning, PLL::Params& params);
@@ -0,0 +1,140 @@
+#include "Convolver.h"
+
+#include <algorithm>
+#include <cmath>
+
+void Convolver::Init(float sample_rate)
+{
+    _sample_rate = sample_rate;
+    SetImpulseResponse(nullptr, 0, sample_rate);
+}
+
+void Convolver::SetImpulseResponse(const float* taps, size_t length, float response_rate)
+{
+    // A response resampled to a higher rate sums over more taps, and the
+    // inverse transform scales by fft_size; both are taken out of the taps.
+    const float step = (response_rate > 0.0f) ? (response_rate / _sample_rate) : 1.0f;
+    const float scale = step / static_cast<float>(fft_size);
+
+    _taps = 0;
+    _partitions = 0;
+    if (taps && length > 0)
+    {
+        _taps = std::min(max_taps, static_cast<size_t>(std::ceil(static_cast<float>(length) / step)));
+        _partitions = (_taps + partition_size - 1) / partition_size;
+    }
+
+    for (size_t p = 0; p < _partitions; ++p)
+    {
+        auto& spectrum = _response[p];
+        spectrum.fill(0.0f);
+        for (size_t i = 0; i < partition_size; ++i)
+        {
+            const size_t n = (p * partition_size) + i;
+            if (n >= _taps)
+            {
+                break;
+            }
+            // Linear interpolation, which is enough to move a cabinet
+            // response between 32, 48 and 96 kHz.
+            const float position = static_cast<float>(n) * step;
+            const auto index = static_cast<size_t>(position);
+            const float fraction = position - static_cast<float>(index);
+            const float a = (index < length) ? taps[index] : 0.0f;
+            const float b = (index + 1 < length) ? taps[index + 1] : 0.0f;
+            spectrum[i] = scale * (a + (fraction * (b - a)));
+        }
+        _fft.Forward(spectrum.data(), spectrum.data());
+    }
+    Reset();
+}
+
+void Convolver::Reset()
+{
+    // Only the past spectra the response reaches back to are ever read.
+    _newest = 0;
+    for (size_t p = 0; p < _partitions; ++p)
+    {
+        _history[(max_partitions - p) % max_partitions].fill(0.0f);
+    }
+    _input.fill(0.0f);
+    _previous_input.fill(0.0f);
+    _output.fill(0.0f);
+    _window.fill(0.0f);
+    _next_output.fill(0.0f);
+    _position = 0;
+    _work_done = WorkUnits();
+}
+
+void Convolver::Process(float* io, size_t size)
+{
+    size_t i = 0;
+    while (i < size)
+    {
+        const size_t count = std::min(size - i, partition_size - _position);
+        for (size_t j = 0; j < count; ++j)
+        {
+            _input[_position + j] = io[i + j];
+            io[i + j] = _output[_position + j];
+        }
+        i += count;
+        _position += count;
+
+        if (_position == partition_size)
+        {
+            StartFrame();
+        }
+        else
+        {
+            // Keep the work in step with the frame, rounding up so it is
+            // always finished by the frame's end.
+            RunWork(((WorkUnits() * _position) + partition_size - 1) / partition_size);
+        }
+    }
+}
+
+void Convolver::StartFrame()
+{
+    RunWork(WorkUnits());
+    _output = _next_output;
+
+    std::copy(_previous_input.begin(), _previous_input.end(), _window.begin());
+    std::copy(_input.begin(), _input.end(), _window.begin() + partition_size);
+    _previous_input = _input;
+    _newest = (_newest + 1) % max_partitions;
+    _position = 0;
+    _work_done = 0;
+}
+
+void Convolver::RunWork(size_t until)
+{
+    until = std::min(until, WorkUnits());
+    for (; _work_done < until; ++_work_done)
+    {
+        if (_work_done == 0)
+        {
+            _fft.Forward(_window.data(), _history[_newest].data());
+            _sum.fill(0.0f);
+        }
+        else if (_work_done <= _partitions)
+        {
+            const size_t p = _work_done - 1;
+            const auto& x = _history[(_newest + max_partitions - p) % max_partitions];
+            const auto& h = _response[p];
+            // DC and Nyquist are real.
+            _sum[0] += x[0] * h[0];
+            _sum[1] += x[1] * h[1];
+            for (size_t k = 2; k < fft_size; k += 2)
+            {
+                _sum[k] += (x[k] * h[k]) - (x[k + 1] * h[k + 1]);
+                _sum[k + 1] += (x[k] * h[k + 1]) + (x[k + 1] * h[k]);
+            }
+        }
+        else
+        {
+            _fft.Inverse(_sum.data(), _sum.data());
+            // Overlap-save: the first half wrapped around.
+            std::copy(_sum.begin() + partition_size, _sum.end(), _next_output.begin());
+        }
+    }
+}
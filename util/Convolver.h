@@ -0,0 +1,72 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <util/RealFft.h>
+
+// Cabinet or body impulse response on the wet signal, by uniformly
+// partitioned FFT convolution (overlap-save).
+//
+// The response is cut into partition_size blocks, each kept as a spectrum.
+// Every partition_size input samples become one new input spectrum, which is
+// multiplied with the response spectra against a delay line of past input
+// spectra, and one inverse FFT gives the next partition_size outputs.
+//
+// The audio blocks are much shorter than a partition, so that work is not
+// done all at once: the frame collected last is transformed, multiplied and
+// transformed back a share at a time over the blocks of the next frame, and
+// played out in the one after. The cost per block stays close to the mean
+// rather than spiking once a partition, at a latency of two partitions.
+class Convolver
+{
+public:
+    static constexpr size_t partition_size = 32;
+    static constexpr size_t max_taps = 2048;
+    static constexpr size_t max_partitions = max_taps / partition_size;
+    // Input to output delay in samples.
+    static constexpr size_t latency = 2 * partition_size;
+
+    void Init(float sample_rate);
+
+    // Loads a response recorded at response_rate, resampled to the running
+    // rate and cut to max_taps. Not safe while Process() runs. A length of
+    // zero leaves the stage off.
+    void SetImpulseResponse(const float* taps, size_t length, float response_rate);
+
+    bool Active() const { return _partitions > 0; }
+    size_t Taps() const { return _taps; }
+
+    // Convolves io in place, delayed by latency.
+    void Process(float* io, size_t size);
+
+    // Forgets the input so far, keeping the response.
+    void Reset();
+
+private:
+    static constexpr size_t fft_size = 2 * partition_size;
+    // Forward transform, one multiply-add per partition, inverse transform.
+    size_t WorkUnits() const { return _partitions + 2; }
+
+    void RunWork(size_t until);
+    void StartFrame();
+
+    RealFft<fft_size> _fft;
+    float _sample_rate = 48000.0f;
+    size_t _taps = 0;
+    size_t _partitions = 0;
+
+    std::array<std::array<float, fft_size>, max_partitions> _response{};
+    // Input spectra, newest at _newest.
+    std::array<std::array<float, fft_size>, max_partitions> _history{};
+    size_t _newest = 0;
+
+    std::array<float, partition_size> _input{};
+    std::array<float, partition_size> _previous_input{};
+    std::array<float, partition_size> _output{};
+    std::array<float, fft_size> _window{};
+    std::array<float, fft_size> _sum{};
+    std::array<float, partition_size> _next_output{};
+    size_t _position = 0;
+    size_t _work_done = 0;
+};
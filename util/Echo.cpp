@@ -0,0 +1,152 @@
+#include "Echo.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <numbers>
+
+#include <daisy_seed.h>
+
+namespace
+{
+
+constexpr uint32_t line_mask = Echo::line_capacity - 1;
+
+// One block's read span: the block itself, stretched by the glide, plus the
+// interpolator's taps on either side.
+constexpr size_t staging_capacity = (2 * Echo::max_block) + 4;
+
+float DSY_SDRAM_BSS line[Echo::line_capacity];
+float DTCM_MEM_SECTION read_staging[staging_capacity];
+float DTCM_MEM_SECTION write_staging[Echo::max_block];
+
+// Contiguous copies in and out of the ring, split where it wraps.
+void ReadLine(uint32_t start, float* out, size_t count)
+{
+    const uint32_t offset = start & line_mask;
+    const size_t head = std::min<size_t>(count, Echo::line_capacity - offset);
+    std::memcpy(out, &line[offset], head * sizeof(float));
+    std::memcpy(out + head, &line[0], (count - head) * sizeof(float));
+}
+
+void WriteLine(uint32_t start, const float* in, size_t count)
+{
+    const uint32_t offset = start & line_mask;
+    const size_t head = std::min<size_t>(count, Echo::line_capacity - offset);
+    std::memcpy(&line[offset], in, head * sizeof(float));
+    std::memcpy(&line[0], in + head, (count - head) * sizeof(float));
+}
+
+// 4-point cubic Hermite between x[1] and x[2].
+float Interpolate(const float* x, float t)
+{
+    const float c1 = 0.5f * (x[2] - x[0]);
+    const float c2 = x[0] - (2.5f * x[1]) + (2.0f * x[2]) - (0.5f * x[3]);
+    const float c3 = (0.5f * (x[3] - x[0])) + (1.5f * (x[1] - x[2]));
+    return (((((c3 * t) + c2) * t) + c1) * t) + x[1];
+}
+
+float OnePoleCoefficient(float corner_hz, float sample_rate)
+{
+    return 1.0f - std::exp(-2.0f * std::numbers::pi_v<float> * corner_hz / sample_rate);
+}
+
+} // namespace
+
+void Echo::Init(float sample_rate)
+{
+    _sample_rate = sample_rate;
+    const float target_delay = _target_delay;
+    _delay = std::clamp(target_delay, min_delay, max_delay);
+    _target_delay = _delay;
+
+    _low_pass_coefficient = OnePoleCoefficient(feedback_low_pass_hz, sample_rate);
+    _high_pass_coefficient = OnePoleCoefficient(feedback_high_pass_hz, sample_rate);
+    _level_step = 1000.0f / (level_ramp_ms * sample_rate);
+
+    std::fill(std::begin(line), std::end(line), 0.0f);
+    _write = 0;
+    _written = line_capacity;
+    _level = 0.0f;
+    _low_pass = 0.0f;
+    _high_pass = 0.0f;
+}
+
+void Echo::Reset()
+{
+    _written = 0;
+    _level = 0.0f;
+    _low_pass = 0.0f;
+    _high_pass = 0.0f;
+}
+
+void Echo::SetDelayMs(uint32_t delay_ms)
+{
+    const float samples = static_cast<float>(delay_ms) * 0.001f * _sample_rate;
+    _target_delay = std::clamp(samples, min_delay, max_delay);
+}
+
+void Echo::SetLevel(float level)
+{
+    _target_level = std::clamp(level, 0.0f, 1.0f);
+}
+
+void Echo::SetFeedback(float feedback)
+{
+    _feedback = std::clamp(feedback, 0.0f, 0.9f);
+}
+
+void Echo::Process(float* io, size_t size)
+{
+    for (size_t begin = 0; begin < size; begin += max_block)
+    {
+        ProcessBlock(io + begin, std::min(max_block, size - begin));
+    }
+}
+
+void Echo::ProcessBlock(float* io, size_t size)
+{
+    const float block = static_cast<float>(size);
+    const float start_delay = _delay;
+    const float glide = block * max_glide;
+    const float target_delay = _target_delay;
+    const float end_delay = std::clamp(target_delay, start_delay - glide, start_delay + glide);
+    const float delay_step = (end_delay - start_delay) / block;
+
+    // Tap positions relative to the block's first sample only move forward,
+    // so the first and last samples bound the span.
+    const auto first = static_cast<int32_t>(std::floor(-(start_delay + delay_step))) - 1;
+    const auto last = static_cast<int32_t>(std::floor(block - 1.0f - end_delay)) + 2;
+    const auto span = static_cast<size_t>(last - first + 1);
+    ReadLine(_write + static_cast<uint32_t>(first), read_staging, span);
+    if (_written < line_capacity)
+    {
+        // Taps from before the last Reset() read silence.
+        const auto stale = -first - static_cast<int32_t>(_written);
+        std::fill_n(read_staging, std::clamp<int32_t>(stale, 0, static_cast<int32_t>(span)), 0.0f);
+    }
+
+    const float feedback = _feedback;
+    const float target_level = _target_level;
+    float delay = start_delay;
+    for (size_t i = 0; i < size; ++i)
+    {
+        delay += delay_step;
+        const float position = static_cast<float>(static_cast<int32_t>(i) - first) - delay;
+        const auto index = static_cast<size_t>(position);
+        const float delayed = Interpolate(&read_staging[index - 1], position - static_cast<float>(index));
+
+        _low_pass += (delayed - _low_pass) * _low_pass_coefficient;
+        _high_pass += (_low_pass - _high_pass) * _high_pass_coefficient;
+        write_staging[i] = io[i] + (feedback * (_low_pass - _high_pass));
+
+        _level += std::clamp(target_level - _level, -_level_step, _level_step);
+        io[i] += _level * delayed;
+    }
+
+    WriteLine(_write, write_staging, size);
+    _write += static_cast<uint32_t>(size);
+    _written = std::min<uint32_t>(line_capacity, _written + static_cast<uint32_t>(size));
+    _delay = end_delay;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tempo echo on the mixed output, with its delay line in SDRAM.
+//
+// SDRAM is slow for scattered single-sample access, so the audio callback
+// never touches the line sample by sample. Each block copies the span its
+// read taps cover into a small staging buffer in DTCM, interpolates from
+// there, and writes its new samples back as one contiguous run. The cost
+// per block is the same for any delay length.
+//
+// Delay changes glide at up to half a sample per sample, like a tape echo
+// whose heads are moved, so tapping a new tempo bends the repeats instead
+// of clicking. The feedback path is band-limited so repeats get darker and
+// the lows don't build up.
+//
+// There is a single line, so only one Echo may exist.
+class Echo
+{
+public:
+    // Up to 5.4 s at 48 kHz, 2.7 s at 96 kHz.
+    static constexpr size_t line_capacity = size_t{1} << 18;
+    // Longer blocks are processed in pieces of this size.
+    static constexpr size_t max_block = 32;
+
+    static constexpr float max_glide = 0.5f;
+    static constexpr float feedback_low_pass_hz = 3200.0f;
+    static constexpr float feedback_high_pass_hz = 120.0f;
+    static constexpr float level_ramp_ms = 20.0f;
+
+    void Init(float sample_rate);
+
+    // Control loop. The level is the echo's share in the output; zero keeps
+    // the line running, so repeats are there as soon as it is turned up.
+    void SetDelayMs(uint32_t delay_ms);
+    void SetLevel(float level);
+    void SetFeedback(float feedback);
+
+    // Audio callback: adds the echo to io in place.
+    void Process(float* io, size_t size);
+
+    // Audio callback: silences the line and the feedback filters. Clearing
+    // the line itself takes far too long here, so what it holds is read as
+    // silence until it has been written over.
+    void Reset();
+
+private:
+    void ProcessBlock(float* io, size_t size);
+
+    // The taps must stay behind the block being written, and ahead of the
+    // oldest sample it overwrites.
+    static constexpr float min_delay = static_cast<float>(max_block + 4);
+    static constexpr float max_delay = static_cast<float>(line_capacity - max_block - 4);
+
+    float _sample_rate = 48000.0f;
+    volatile float _target_delay = 24000.0f;
+    volatile float _target_level = 0.0f;
+    volatile float _feedback = 0.4f;
+
+    uint32_t _write = 0;
+    // Samples written since the line was last silent, up to line_capacity.
+    uint32_t _written = line_capacity;
+    float _delay = 24000.0f;
+    float _level = 0.0f;
+    float _level_step = 0.001f;
+    float _low_pass_coefficient = 0.3f;
+    float _high_pass_coefficient = 0.02f;
+    float _low_pass = 0.0f;
+    float _high_pass = 0.0f;
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free ring buffer for one producer and one consumer, for example an
+// interrupt handler feeding the control loop or the audio callback. Push()
+// fails rather than overwrite when the consumer falls behind.
+template <typename T, size_t Capacity>
+class EventQueue
+{
+public:
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+    bool Push(const T& item)
+    {
+        const auto head = _head.load(std::memory_order_relaxed);
+        if (head - _tail.load(std::memory_order_acquire) >= Capacity)
+        {
+            return false;
+        }
+        _items[head % Capacity] = item;
+        _head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Looks at the oldest item without consuming it.
+    bool Peek(T& item) const
+    {
+        const auto tail = _tail.load(std::memory_order_relaxed);
+        if (tail == _head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        item = _items[tail % Capacity];
+        return true;
+    }
+
+    bool Pop(T& item)
+    {
+        if (!Peek(item))
+        {
+            return false;
+        }
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    std::atomic<uint32_t> _head{0};
+    std::atomic<uint32_t> _tail{0};
+    std::array<T, Capacity> _items{};
+};
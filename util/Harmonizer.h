@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Phase-coherent voice bank driven by a single 32-bit master phase.
+//
+// The master accumulator runs at the fundamental divided by
+// ratio_denominator, so every voice ratio that is a multiple of
+// 1/ratio_denominator is an integer multiply of the master phase. All voices
+// wrap together when the master wraps, so they can never drift apart, and
+// each extra voice costs one multiply plus one table lookup.
+class Harmonizer
+{
+public:
+    static constexpr int max_voices = 8;
+
+    // Common denominator of the halves, thirds, quarters and eighths used by
+    // the pitch interval controls.
+    static constexpr uint32_t ratio_denominator = 24;
+
+    // Largest ratio that still fits the multiplier without losing coherence.
+    static constexpr float max_ratio = 8.0f;
+
+    void Init(float sample_rate)
+    {
+        _phase_scale = phase_range / (ratio_denominator * sample_rate);
+        _master_phase = 0;
+        _increment = 0;
+    }
+
+    void Reset()
+    {
+        _master_phase = 0;
+        for (auto& v : _voices)
+        {
+            v.divider_count = 0;
+        }
+    }
+
+    void SetFrequency(float fundamental_hz)
+    {
+        _increment = static_cast<uint32_t>(std::max(fundamental_hz, 0.0f) * _phase_scale);
+    }
+
+    // Ratios are snapped to the nearest 1/ratio_denominator.
+    void SetRatio(int voice, float ratio)
+    {
+        const float clamped = std::clamp(ratio, 0.0f, max_ratio);
+        _voices[voice].multiplier =
+            static_cast<uint32_t>(std::lround(clamped * ratio_denominator));
+    }
+
+    // Only picks the shape tables to mix, so a shape can change every
+    // control tick, as it does in a preset morph.
+    void SetShape(int voice, float shape)
+    {
+        _voices[voice].shape = ShapeMix(shape);
+    }
+
+    // Turns a voice into a chain of flip-flops clocked by another voice's
+    // wraps, like an analog octave divider: a square at the parent's pitch
+    // over 2^stages, whatever the voice's own ratio. It follows every cycle
+    // of the parent, glides and vibrato included. Zero stages turns it off.
+    void SetDivider(int voice, int parent, int stages)
+    {
+        auto& v = _voices[voice];
+        v.divider_parent = parent;
+        v.divider_stages = std::clamp(stages, 0, 3);
+    }
+
+    void Advance()
+    {
+        const uint32_t previous = _master_phase;
+        _master_phase += _increment;
+        for (auto& v : _voices)
+        {
+            if (v.divider_stages > 0)
+            {
+                const uint32_t multiplier = _voices[v.divider_parent].multiplier;
+                if ((_master_phase * multiplier) < (previous * multiplier))
+                {
+                    ++v.divider_count;
+                }
+            }
+        }
+    }
+
+    uint32_t VoicePhase(int voice) const
+    {
+        return _master_phase * _voices[voice].multiplier;
+    }
+
+    float operator()(int voice) const
+    {
+        const auto& v = _voices[voice];
+        if (v.divider_stages > 0)
+        {
+            return ((v.divider_count >> (v.divider_stages - 1)) & 1u) ? -1.0f : 1.0f;
+        }
+        return ShapedSample(v.shape, VoicePhase(voice));
+    }
+
+    // A shape as a mix of the two neighbouring tables of shape_tables.
+    struct Mix
+    {
+        int segment = 1;
+        float fraction = 0.0f;
+    };
+
+    static Mix ShapeMix(float shape)
+    {
+        const float clamped = std::clamp(shape, 0.0f, 3.0f);
+        const int segment = std::min(static_cast<int>(clamped), 2);
+        return Mix{segment, clamped - static_cast<float>(segment)};
+    }
+
+    static float ShapedSample(const Mix& mix, uint32_t phase)
+    {
+        const size_t index = phase >> (32 - table_bits);
+        return std::lerp(
+            shape_tables[mix.segment][index],
+            shape_tables[mix.segment + 1][index],
+            mix.fraction);
+    }
+
+    // 0.0 - 1.0: Pulse - Square
+    // 1.0 - 2.0: Square - Triangle
+    // 2.0 - 3.0: Triangle - Sawtooth
+    static float RenderShapedPhase(float phase_value, float shape)
+    {
+        const float ph = phase_value - std::floor(phase_value);
+        const float pulse = (ph < 0.2f) ? 1.0f : -1.0f;
+        const float square = (ph < 0.5f) ? 1.0f : -1.0f;
+        const float triangle = 1.0f - (4.0f * std::abs(ph - 0.5f));
+        const float saw = (2.0f * ph) - 1.0f;
+
+        const float s = std::clamp(shape, 0.0f, 3.0f);
+        if (s < 1.0f)
+        {
+            return std::lerp(pulse, square, s);
+        }
+        if (s < 2.0f)
+        {
+            return std::lerp(square, triangle, s - 1.0f);
+        }
+        return std::lerp(triangle, saw, s - 2.0f);
+    }
+
+private:
+    static constexpr int table_bits = 8;
+    static constexpr size_t table_size = size_t{1} << table_bits;
+    static constexpr float phase_range = 4294967296.0f;
+
+    using ShapeTables = std::array<std::array<float, table_size>, 4>;
+
+    // RenderShapedPhase() is linear in the shape between pulse, square,
+    // triangle and saw, so those four tables give every shape exactly.
+    static ShapeTables RenderShapeTables()
+    {
+        ShapeTables tables{};
+        for (size_t shape = 0; shape < tables.size(); ++shape)
+        {
+            for (size_t i = 0; i < table_size; ++i)
+            {
+                const float ph = static_cast<float>(i) / table_size;
+                tables[shape][i] = RenderShapedPhase(ph, static_cast<float>(shape));
+            }
+        }
+        return tables;
+    }
+
+    inline static const ShapeTables shape_tables = RenderShapeTables();
+
+    struct Voice
+    {
+        uint32_t multiplier = ratio_denominator;
+        Mix shape{};
+        int divider_parent = 0;
+        int divider_stages = 0;
+        uint32_t divider_count = 0;
+    };
+
+    std::array<Voice, max_voices> _voices{};
+    uint32_t _master_phase = 0;
+    uint32_t _increment = 0;
+    float _phase_scale = phase_range / (ratio_denominator * 48000.0f);
+};
@@ -23,6 +23,11 @@ public:
         return _value;
     }
 
+    float Value() const
+    {
+        return _value;
+    }
+
 private:
     float _value;
     float _step;
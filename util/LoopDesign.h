@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cmath>
+#include <numbers>
+#include <type_traits>
+
+#include <gcem.hpp>
+
+// PLL loop filter design from the loop dynamics rather than raw gains.
+//
+// The phase detector measures the error in cycles, so its gain is one, and
+// the VCO runs at
+//
+//     kp * error + ki * integral(error)
+//
+// on top of the FLL's estimate. That is a type 2 second-order loop,
+// s^2 + kp s + ki, with kp = 2 zeta wn and ki = wn^2 (wn in rad/s). The
+// one-pole phase error filter adds a third pole, which error_filter_ratio
+// keeps far enough above wn for the second-order response to hold; the
+// VCO settle smoother (2 ms) sits above both.
+//
+// This holds from PLL::loop_scale_reference_hz up. The phase detector only
+// updates once a cycle, so below that pitch the PLL scales kp with the
+// pitch and ki with its square: wn falls in proportion and the damping
+// stays the same.
+struct LoopDesign
+{
+    float natural_hz = 17.4f;
+    float damping = 0.82f;
+    // How far the integrator may pull the VCO away from the FLL's estimate.
+    float lock_range_hz = 300.0f;
+    // Error filter corner as a multiple of the natural frequency.
+    float error_filter_ratio = 8.0f;
+};
+
+// The gains as PLL::Params holds them. ki and the error filter alpha are per
+// sample at loop_reference_rate, kp and the limit don't depend on the rate.
+struct LoopGains
+{
+    float kp_hz;
+    float ki_hz;
+    float error_filter_alpha;
+    float integrator_limit_hz;
+};
+
+// Per-sample coefficients at one sample rate.
+struct LoopCoefficients
+{
+    float kp_hz;
+    float integrator_step;
+    float error_filter_coefficient;
+    float integrator_limit_hz;
+};
+
+constexpr float loop_reference_rate = 48000.0f;
+
+namespace loop_design
+{
+
+// gcem when evaluated at compile time, the library functions when a menu
+// redesigns the loop at run time.
+constexpr float Exp(float x)
+{
+    return std::is_constant_evaluated() ? gcem::exp(x) : std::exp(x);
+}
+
+constexpr float Log(float x)
+{
+    return std::is_constant_evaluated() ? gcem::log(x) : std::log(x);
+}
+
+constexpr float Sqrt(float x)
+{
+    return std::is_constant_evaluated() ? gcem::sqrt(x) : std::sqrt(x);
+}
+
+} // namespace loop_design
+
+constexpr LoopGains DesignLoop(const LoopDesign& design)
+{
+    const float natural = 2.0f * std::numbers::pi_v<float> * design.natural_hz;
+    const float filter_pole = design.error_filter_ratio * natural;
+    return LoopGains{
+        2.0f * design.damping * natural,
+        natural * natural / loop_reference_rate,
+        1.0f - loop_design::Exp(-filter_pole / loop_reference_rate),
+        design.lock_range_hz,
+    };
+}
+
+// Inverse of DesignLoop(). Without an integrator the loop is first order and
+// comes back with zero natural frequency and damping.
+constexpr LoopDesign AnalyzeLoop(const LoopGains& gains)
+{
+    const float natural = loop_design::Sqrt(gains.ki_hz * loop_reference_rate);
+    if (natural <= 0.0f)
+    {
+        return LoopDesign{0.0f, 0.0f, gains.integrator_limit_hz, 0.0f};
+    }
+    const float filter_pole = -loop_design::Log(1.0f - gains.error_filter_alpha) * loop_reference_rate;
+    return LoopDesign{
+        natural / (2.0f * std::numbers::pi_v<float>),
+        gains.kp_hz / (2.0f * natural),
+        gains.integrator_limit_hz,
+        filter_pole / natural,
+    };
+}
+
+constexpr LoopCoefficients DiscretizeLoop(const LoopGains& gains, float sample_rate)
+{
+    const float rate_ratio = loop_reference_rate / sample_rate;
+    return LoopCoefficients{
+        gains.kp_hz,
+        gains.ki_hz * rate_ratio,
+        1.0f - loop_design::Exp(loop_design::Log(1.0f - gains.error_filter_alpha) * rate_ratio),
+        gains.integrator_limit_hz,
+    };
+}
+
+inline constexpr LoopGains default_loop_gains = DesignLoop(LoopDesign{});
@@ -0,0 +1,155 @@
+#include "MidiOut.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+
+constexpr uint8_t note_off_status = 0x80;
+constexpr uint8_t note_on_status = 0x90;
+constexpr uint8_t pitch_bend_status = 0xE0;
+
+// MIDI key number, fractional.
+float Semitones(float frequency_hz)
+{
+    return 69.0f + (12.0f * std::log2(frequency_hz / 440.0f));
+}
+
+} // namespace
+
+void MidiOut::Init(float sample_rate, uint8_t channel)
+{
+    _channel = channel & 0x0F;
+    _bend_hysteresis = static_cast<int>(
+        std::lround(8192.0f * bend_hysteresis_cents / (100.0f * bend_range_semitones)));
+    _bend_interval_samples = std::max<uint32_t>(1, std::lround(bend_interval_s * sample_rate));
+    _unlock_release_samples = std::max<uint32_t>(1, std::lround(unlock_release_s * sample_rate));
+    _bend_stale_samples = std::max<uint32_t>(1, std::lround(bend_stale_s * sample_rate));
+
+    daisy::MidiUartHandler::Config config;
+    _uart.Init(config);
+}
+
+void MidiOut::Process(const PLL& pll)
+{
+    _sample.store(_sample.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    if (_pending_note_off >= 0)
+    {
+        if (!Push(note_off_status, static_cast<uint8_t>(_pending_note_off), 0))
+        {
+            return;
+        }
+        _pending_note_off = -1;
+    }
+
+    const bool gate = pll.GateOpen();
+    const bool locked = pll.Locked();
+    if (_note < 0)
+    {
+        if (gate && locked)
+        {
+            NoteOn(pll);
+        }
+        return;
+    }
+
+    if (!gate)
+    {
+        NoteOff();
+        return;
+    }
+
+    // Hold the note and its bend through short dropouts.
+    if (!locked)
+    {
+        if (++_unlocked_samples >= _unlock_release_samples)
+        {
+            NoteOff();
+        }
+        return;
+    }
+    _unlocked_samples = 0;
+
+    if (--_bend_countdown > 0)
+    {
+        return;
+    }
+    _bend_countdown = _bend_interval_samples;
+
+    const float offset = Semitones(pll.MeasuredFrequency()) - static_cast<float>(_note);
+    if (std::abs(offset) >= note_change_semitones)
+    {
+        NoteOff();
+        NoteOn(pll);
+        return;
+    }
+    Bend(offset);
+}
+
+void MidiOut::Send()
+{
+    const uint32_t now = _sample.load(std::memory_order_relaxed);
+    MidiMessage message;
+    while (_messages.Pop(message))
+    {
+        MidiMessage next;
+        const bool stale = (message.bytes[0] & 0xF0) == pitch_bend_status
+            && (now - message.sample) > _bend_stale_samples
+            && _messages.Peek(next);
+        if (!stale)
+        {
+            _uart.SendMessage(message.bytes.data(), message.size);
+        }
+    }
+}
+
+void MidiOut::NoteOn(const PLL& pll)
+{
+    const float semitones = Semitones(std::max(pll.MeasuredFrequency(), 1.0f));
+    _note = std::clamp(static_cast<int>(std::lround(semitones)), 0, 127);
+
+    // The bend goes first so the note starts at the right pitch.
+    Bend(semitones - static_cast<float>(_note));
+
+    const float level = std::min(pll.InputEnvelope() / velocity_full_scale, 1.0f);
+    const auto velocity = static_cast<uint8_t>(std::clamp(
+        static_cast<int>(std::lround(127.0f * std::sqrt(level))), 1, 127));
+    Push(note_on_status, static_cast<uint8_t>(_note), velocity);
+
+    _bend_countdown = _bend_interval_samples;
+    _unlocked_samples = 0;
+}
+
+void MidiOut::NoteOff()
+{
+    if (!Push(note_off_status, static_cast<uint8_t>(_note), 0))
+    {
+        _pending_note_off = _note;
+    }
+    _note = -1;
+}
+
+void MidiOut::Bend(float offset_semitones)
+{
+    const int bend = std::clamp(
+        static_cast<int>(std::lround(8192.0f + (8192.0f * offset_semitones / bend_range_semitones))),
+        0, 16383);
+    if (std::abs(bend - _bend) < _bend_hysteresis)
+    {
+        return;
+    }
+    _bend = bend;
+    Push(pitch_bend_status, static_cast<uint8_t>(bend & 0x7F), static_cast<uint8_t>(bend >> 7));
+}
+
+bool MidiOut::Push(uint8_t status, uint8_t data1, uint8_t data2)
+{
+    const MidiMessage message{
+        _sample.load(std::memory_order_relaxed),
+        3,
+        {static_cast<uint8_t>(status | _channel), data1, data2},
+    };
+    return _messages.Push(message);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <daisy_seed.h>
+
+#include <util/EventQueue.h>
+#include <util/PLL.h>
+
+struct MidiMessage
+{
+    // Audio sample the message was generated at.
+    uint32_t sample;
+    uint8_t size;
+    std::array<uint8_t, 3> bytes;
+};
+
+// Pitch-to-MIDI from the PLL's tracking state, sent on the Seed's UART MIDI
+// pins (D13 out).
+//
+// The audio callback turns gate and lock transitions into note-on/off and
+// the measured pitch into pitch bend, and queues the messages with the
+// sample they were generated at. Notes start only once the loop is locked,
+// and bends are frozen while it isn't, so nothing is sent from an unlocked
+// loop. A note that drifts too far away from its key is ended and the new
+// one started; smaller offsets are sent as pitch bend.
+//
+// The control loop sends whatever is queued, ideally while it waits for its
+// next tick so notes go out without waiting a whole tick.
+class MidiOut
+{
+public:
+    static constexpr size_t queue_size = 64;
+    // The receiver's default bend range.
+    static constexpr float bend_range_semitones = 2.0f;
+    // Past this offset from the sounding key, the note is replaced.
+    static constexpr float note_change_semitones = 0.7f;
+    static constexpr float bend_hysteresis_cents = 3.0f;
+    // A 3-byte message takes about 1 ms at 31250 baud.
+    static constexpr float bend_interval_s = 0.004f;
+    static constexpr float unlock_release_s = 0.02f;
+    // Bends older than this are dropped when something newer is queued.
+    static constexpr float bend_stale_s = 0.008f;
+    // Input envelope that maps to velocity 127.
+    static constexpr float velocity_full_scale = 0.5f;
+
+    using Queue = EventQueue<MidiMessage, queue_size>;
+
+    void Init(float sample_rate, uint8_t channel = 0);
+
+    // Call from the audio callback after every PLL::Process() or Track().
+    void Process(const PLL& pll);
+
+    // Call from the control loop.
+    void Send();
+
+private:
+    void NoteOn(const PLL& pll);
+    void NoteOff();
+    void Bend(float offset_semitones);
+    bool Push(uint8_t status, uint8_t data1, uint8_t data2);
+
+    daisy::MidiUartHandler _uart;
+    Queue _messages;
+    std::atomic<uint32_t> _sample{0};
+    uint8_t _channel = 0;
+
+    int _note = -1;
+    // A note-off the full queue refused, retried before anything else so
+    // the receiver is never left with a stuck note.
+    int _pending_note_off = -1;
+    int _bend = 8192;
+    int _bend_hysteresis = 12;
+    uint32_t _bend_interval_samples = 192;
+    uint32_t _bend_countdown = 0;
+    uint32_t _unlock_release_samples = 960;
+    uint32_t _unlocked_samples = 0;
+    uint32_t _bend_stale_samples = 384;
+};
@@ -1,29 +1,70 @@
 #pragma once
 
-#include <q/synth/noise_gen.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 
+// Sample-and-hold white noise.
+//
+// Random values are generated a block at a time by interleaved xorshift32
+// lanes. Lanes are independent, so the refill loop has no serial dependency
+// and the compiler can vectorize it; the per-sample path is just a counter.
 class NoiseSynth
 {
 public:
-    void setSampleDuration(int duration)
+    // Number of samples each random value is held for. Fractional durations
+    // are accumulated so the hold rate can track a pitch exactly.
+    void setSampleDuration(float duration)
     {
-        _sample_duration = duration;
+        _sample_duration = (duration < 1.0f) ? 1.0f : duration;
     }
 
     float operator()()
     {
-        _ticks++;
+        _ticks += 1.0f;
         if (_ticks >= _sample_duration)
         {
-            _ticks = 0;
-            _last_sample = _noise();
+            _ticks -= _sample_duration;
+            _last_sample = next();
         }
         return _last_sample;
     }
 
 private:
-    cycfi::q::white_noise_gen _noise;
+    static constexpr size_t lanes = 4;
+    static constexpr size_t block_size = 32;
+    static constexpr float scale = 1.0f / 2147483648.0f;
+
+    float next()
+    {
+        if (_index >= block_size)
+        {
+            refill();
+        }
+        return _block[_index++];
+    }
+
+    void refill()
+    {
+        for (size_t i = 0; i < block_size; i += lanes)
+        {
+            for (size_t lane = 0; lane < lanes; ++lane)
+            {
+                uint32_t x = _state[lane];
+                x ^= x << 13;
+                x ^= x >> 17;
+                x ^= x << 5;
+                _state[lane] = x;
+                _block[i + lane] = static_cast<float>(static_cast<int32_t>(x)) * scale;
+            }
+        }
+        _index = 0;
+    }
+
+    std::array<uint32_t, lanes> _state{0x9E3779B9u, 0x243F6A88u, 0xB7E15162u, 0x85A308D3u};
+    std::array<float, block_size> _block{};
+    size_t _index = block_size;
     float _last_sample = 0;
-    int _sample_duration = 0;
-    int _ticks = 0;
+    float _sample_duration = 1;
+    float _ticks = 0;
 };
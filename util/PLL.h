@@ -1,17 +1,25 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <numbers>
 
 #include <q/fx/envelope.hpp>
 #include <q/fx/noise_gate.hpp>
 #include <q/support/literals.hpp>
 
 #include <util/Fuzz.h>
+#include <util/Harmonizer.h>
+#include <util/HilbertPair.h>
 #include <util/LinearRamp.h>
+#include <util/LoopDesign.h>
 #include <util/Mapping.h>
 #include <util/NoiseSynth.h>
+#include <util/PolyTracker.h>
+#include <util/Resynthesizer.h>
 #include <util/SvFilter.h>
+#include <util/TempoLfo.h>
 #include <util/WaveSynth.h>
 
 namespace q = cycfi::q;
@@ -26,16 +34,53 @@ public:
         float fuzz_level = 0.5f;
         float osc_level = 0.8f;
         float sub_level = 0.6f;
+        float noise_level = 0.5f;
         float trigger_ratio = 0.2f;
         float wave_shape = 1.0f; // 0..3
         float sub_wave_shape = 1.0f; // 0..3
         float main_pitch_multiplier = 2.0f;
         float sub_pitch_multiplier = 0.5f;
-        float pll_kp_hz = 180.0f;
-        float pll_ki_hz = 0.25f;
-        float pll_error_filter_alpha = 0.0035f;
-        float pll_integrator_limit_hz = 300.0f;
+        // Loop gains, normally set from a LoopDesign with SetLoop(). The
+        // integrator gain and the error filter coefficient are per sample
+        // at loop_reference_rate. Other rates are scaled to match.
+        float pll_kp_hz = default_loop_gains.kp_hz;
+        float pll_ki_hz = default_loop_gains.ki_hz;
+        float pll_error_filter_alpha = default_loop_gains.error_filter_alpha;
+        float pll_integrator_limit_hz = default_loop_gains.integrator_limit_hz;
         float glide_speed = 0.25f; // 0 = slow glide, 1 = instant
+        // Smoothing of the VCO frequency the glide heads for, independent
+        // of the glide speed.
+        float glide_follow_s = 0.00346f;
+        // Share of the per-cycle frequency error fed to the VCO by the
+        // period-counting front end. 0 leaves acquisition to the PFD.
+        float fll_gain = 0.5f;
+        // Phase detector. The default compares input and VCO edges once a
+        // cycle. The quadrature detector compares the VCO phase with the
+        // phase of the input's analytic signal every sample instead.
+        bool quadrature_detector = false;
+        // Cross wah corner as a multiple of the tracked pitch, and its
+        // resonance at full fuzz level.
+        float wah_tracking_ratio = 1.15f;
+        float wah_q_max = 6.0f;
+        // Low-pass the edge detector input just above the tracked pitch once
+        // locked, so strong upper harmonics don't add edges.
+        bool input_prefilter = true;
+        // Restart acquisition on every pick transient or legato pitch change,
+        // seeded from recently locked pitches.
+        bool onset_reacquire = true;
+        // Chord mode: the main oscillator is replaced by one voice per
+        // string, tracked by PolyTracker. The loop above still drives the
+        // sub, harmony voices and wah.
+        bool poly_tracking = false;
+        // The main oscillator plays the input's own harmonics, measured at
+        // the tracked pitch, instead of a wave shape. Chord mode wins.
+        bool resynthesis = false;
+        int resynthesis_harmonics = 12;
+        // Tempo LFO modulation depths. Pitch is a fraction of the frequency,
+        // wah is a fraction of the corner and level is the tremolo depth.
+        float lfo_pitch_depth = 0.0f;
+        float lfo_wah_depth = 0.0f;
+        float lfo_level_depth = 0.0f;
         bool gate_enabled = true;
         bool noise_mode = false;
         bool envelope_follow = true;
@@ -44,47 +89,175 @@ public:
         bool raw_osc_only = false;
         bool use_vco_phase_output = true;
         bool vibrato_mode = false;
+        // The sub voice divides the main voice down by flip-flops instead
+        // of playing its own ratio; sub_pitch_multiplier sets the octaves.
+        bool flip_flop_divider = false;
+        // Extra harmonizer voices on top of the main and sub voices. Ratios are
+        // relative to the tracked fundamental and snap to 1/24 steps. The
+        // controls only add them in harmony mode.
+        bool harmony_mode = false;
+        int harmony_voice_count = 0;
+        float harmony_level = 0.0f;
+        std::array<float, Harmonizer::max_voices - 2> harmony_ratios{
+            1.5f, 1.25f, 0.75f, 3.0f, 2.0f, 0.5f};
+
+        constexpr void SetLoop(const LoopDesign& design)
+        {
+            const auto gains = DesignLoop(design);
+            pll_kp_hz = gains.kp_hz;
+            pll_ki_hz = gains.ki_hz;
+            pll_error_filter_alpha = gains.error_filter_alpha;
+            pll_integrator_limit_hz = gains.integrator_limit_hz;
+        }
     };
 
+    // Call again to change the sample rate. All per-sample coefficients are
+    // derived here from times and frequencies, so every rate sounds alike.
     void Init(float sample_rate_hz)
     {
         sample_rate = sample_rate_hz;
+        sample_period = 1.0f / sample_rate;
+        UpdateRateCoefficients();
+        UpdateLoopCoefficients();
+
         gate_envelope = 0.0f;
+        gate_open = false;
+        input_envelope = 0.0f;
         vco_phase = 0.0f;
-        output_phase = 0.0f;
-        sub_vco_phase = 0.0f;
+        vco_edge_armed = true;
         vco_frequency = free_run_frequency_hz;
         glide_frequency = free_run_frequency_hz;
         glide_target_frequency = free_run_frequency_hz;
         pfd_input_latch = false;
         pfd_vco_latch = false;
+        pfd_pending_samples = 0.0f;
+        pfd_pair_samples = 0.0f;
+        pfd_last_interval = 1.0f;
+        pfd_held_error = 0.0f;
         filtered_phase_error = 0.0f;
         pll_integrator = 0.0f;
+        fll_frequency = 0.0f;
+        input_periods = {};
+        samples_since_input_edge = 0;
+        last_input_edge = 0.0f;
+        input_edge_valid = false;
+        lock_count = 0;
+        loop_scale = 1.0f;
+        measured_frequency = 0.0f;
+        onset_prev_sample = 0.0f;
+        onset_peak = 0.0f;
+        onset_average = 0.0f;
+        onset_holdoff = 0;
+        reacquire_pending = false;
+        candidate_period = 0.0f;
+        recent_frequencies = {};
 
         envelope_follower = q::peak_envelope_follower{10_ms, sample_rate};
         gate = q::noise_gate{-120_dB};
-        gate_ramp = LinearRamp{0.0f, 0.008f};
-        output_mute_ramp = LinearRamp{0.0f, 0.0025f};
+        gate_ramp = LinearRamp{0.0f, sample_period / gate_ramp_s};
+        output_mute_ramp = LinearRamp{0.0f, sample_period / output_mute_ramp_s};
         cross_wah_filter.config(800_Hz, sample_rate, osc_wah_q_min);
+        prefilter_countdown = 0;
+        prefilter_tracking = false;
+        prefilter_corner = prefilter_open_hz;
+        prefilter = SvFilter{};
+        ConfigurePrefilter();
 
         wave_synth.setShape(1.0f);
         sub_wave_synth.setShape(2.2f);
+
+        harmonizer.Init(sample_rate);
+        poly_tracker.Init(sample_rate);
+        resynthesizer.Init(sample_rate);
+        ApplyHarmonizerParams();
+
+        lfo.Init(sample_rate);
+        lfo_value = 0.0f;
     }
 
-    float Process(float dry_signal)
+    // Call once at the start of every audio block, before Process().
+    void BeginBlock(size_t size)
     {
-        const float dry_envelope = envelope_follower(std::abs(dry_signal));
-        ConfigureGate(params.trigger_ratio);
+        lfo.NextBlock(size);
+        if (params.resynthesis)
+        {
+            // Only a locked pitch is worth measuring harmonics of.
+            resynthesizer.SetFundamental(
+                Locked() ? vco_frequency : 0.0f,
+                glide_frequency * params.main_pitch_multiplier);
+        }
+    }
 
-        const bool gate_state = params.gate_enabled ? gate(dry_envelope) : true;
-        gate_envelope = gate_ramp(gate_state ? 1.0f : 0.0f);
+    void SetLfoPeriodMs(uint32_t period_ms)
+    {
+        lfo.SetPeriodMs(period_ms);
+    }
 
-        const bool input_edge = DetectInputRisingEdge(dry_signal, gate_state);
-        const bool vco_edge = DetectVcoRisingEdge();
-        UpdatePll(input_edge, vco_edge, gate_state);
+    void SyncLfo()
+    {
+        lfo.Sync();
+    }
+
+    // True once the period estimate and the VCO have agreed for a few cycles.
+    bool Locked() const
+    {
+        return lock_count >= lock_periods;
+    }
+
+    // Tracking state as of the last Process() or Track() call.
+    bool GateOpen() const
+    {
+        return gate_open;
+    }
+
+    float InputEnvelope() const
+    {
+        return input_envelope;
+    }
+
+    // Pitch from the averaged input period, updated every cycle. It is
+    // settled once Locked(), while the VCO may still be catching up.
+    float MeasuredFrequency() const
+    {
+        return measured_frequency;
+    }
+
+    // Pitch the oscillator glides towards: the VCO, smoothed by
+    // glide_follow_s.
+    float TrackedFrequency() const
+    {
+        return glide_target_frequency;
+    }
+
+    // Warm standby for bypass: runs the gate, the edge detectors and both
+    // loops and keeps the oscillator phases moving, but renders nothing, so
+    // Process() can take over again without reacquiring.
+    void Track(float dry_signal)
+    {
+        float dry_envelope;
+        TrackInput(dry_signal, dry_envelope);
+        if (params.poly_tracking)
+        {
+            poly_tracker.Track(dry_signal);
+        }
+        AdvanceOscillator();
+        output_mute_ramp(glide_frequency > mute_frequency_hz ? 1.0f : 0.0f);
+    }
+
+    float Process(float dry_signal)
+    {
+        float dry_envelope;
+        const bool gate_state = TrackInput(dry_signal, dry_envelope);
+        AdvanceOscillator();
 
         wave_synth.setShape(params.wave_shape);
-        const float osc_signal = GenerateMainOscillator();
+        float osc_signal = params.poly_tracking
+            ? poly_tracker.Process(dry_signal)
+            : GenerateMainOscillator();
+        if (params.harmony_voice_count > 0)
+        {
+            osc_signal += GenerateHarmonyVoices() * params.harmony_level;
+        }
         float osc_voice = osc_signal;
         sub_wave_synth.setShape(params.sub_wave_shape);
 
@@ -112,12 +285,13 @@ public:
         if (gate_state && osc_fx_enabled)
         {
             const float fuzz_mag = std::clamp(std::abs(fuzz_voice), 0.0f, 1.0f);
+            const float wah_mod = 1.0f + (lfo_value * params.lfo_wah_depth);
             const float tracked_hz = std::clamp(
-                glide_frequency * osc_wah_tracking_ratio,
+                glide_frequency * params.wah_tracking_ratio * wah_mod,
                 osc_wah_min_hz,
                 osc_wah_max_hz);
-            const float dynamic_q = std::lerp(osc_wah_q_min, osc_wah_q_max, fuzz_mag);
-            cross_wah_filter.config(tracked_hz * 1_Hz, sample_rate, dynamic_q);
+            const float dynamic_q = std::lerp(osc_wah_q_min, params.wah_q_max, fuzz_mag);
+            cross_wah_filter.configNormalized(tracked_hz * sample_period, dynamic_q);
             cross_wah_filter.update(osc_signal);
 
             const float resonant_osc = std::lerp(
@@ -150,8 +324,15 @@ public:
         }
 
         const float fuzz_contrib = fuzz_voice * params.fuzz_level;
-        const float osc_contrib = osc_voice * params.osc_level;
-        const float sub_contrib = sub_voice * params.sub_level;
+        const float tremolo = 1.0f - (params.lfo_level_depth * (0.5f + (0.5f * lfo_value)));
+        float osc_contrib = osc_voice * params.osc_level * tremolo;
+        if (params.noise_mode)
+        {
+            // The noise voice shares the osc slot of the bus so it takes part
+            // in all of the heterodyne terms below at no extra cost.
+            osc_contrib += GenerateNoiseVoice() * params.noise_level;
+        }
+        const float sub_contrib = sub_voice * params.sub_level * tremolo;
 
         const float additive_mix = fuzz_contrib + osc_contrib + sub_contrib;
 
@@ -182,19 +363,176 @@ public:
         params.fuzz_level = std::clamp(params.fuzz_level, 0.0f, 2.0f);
         params.osc_level = std::clamp(params.osc_level, 0.0f, 2.0f);
         params.sub_level = std::clamp(params.sub_level, 0.0f, 2.0f);
+        params.noise_level = std::clamp(params.noise_level, 0.0f, 2.0f);
         params.trigger_ratio = std::clamp(params.trigger_ratio, 0.0f, 1.0f);
         params.wave_shape = std::clamp(params.wave_shape, 0.0f, 3.0f);
         params.sub_wave_shape = std::clamp(params.sub_wave_shape, 0.0f, 3.0f);
-        params.main_pitch_multiplier = std::clamp(params.main_pitch_multiplier, 1.0f, 4.0f);
+        params.main_pitch_multiplier = std::clamp(params.main_pitch_multiplier, 1.0f, max_main_pitch_multiplier);
         params.sub_pitch_multiplier = std::clamp(params.sub_pitch_multiplier, 0.125f, 0.75f);
         params.pll_kp_hz = std::clamp(params.pll_kp_hz, 20.0f, 800.0f);
         params.pll_ki_hz = std::clamp(params.pll_ki_hz, 0.0f, 3.0f);
         params.pll_error_filter_alpha = std::clamp(params.pll_error_filter_alpha, 0.0005f, 0.05f);
         params.pll_integrator_limit_hz = std::clamp(params.pll_integrator_limit_hz, 20.0f, 800.0f);
         params.glide_speed = std::clamp(params.glide_speed, 0.0f, 1.0f);
+        params.glide_follow_s = std::clamp(params.glide_follow_s, 0.0002f, 0.05f);
+        params.fll_gain = std::clamp(params.fll_gain, 0.0f, 1.0f);
+        params.wah_tracking_ratio = std::clamp(params.wah_tracking_ratio, 0.5f, 4.0f);
+        params.wah_q_max = std::clamp(params.wah_q_max, osc_wah_q_min, 12.0f);
+        params.lfo_pitch_depth = std::clamp(params.lfo_pitch_depth, 0.0f, 0.25f);
+        params.lfo_wah_depth = std::clamp(params.lfo_wah_depth, 0.0f, 0.9f);
+        params.lfo_level_depth = std::clamp(params.lfo_level_depth, 0.0f, 1.0f);
+        params.harmony_voice_count =
+            std::clamp(params.harmony_voice_count, 0, Harmonizer::max_voices - 2);
+        params.harmony_level = std::clamp(params.harmony_level, 0.0f, 2.0f);
+        params.resynthesis_harmonics = std::clamp(
+            params.resynthesis_harmonics, 1, static_cast<int>(Resynthesizer::max_harmonics));
+        ApplyHarmonizerParams();
+        UpdateLoopCoefficients();
     }
 
+    // Ceiling of the main oscillator at any interval: the master phase stops
+    // at max_frequency_hz over the main multiplier.
+    static constexpr float max_frequency_hz = 2400.0f;
+    static constexpr float max_main_pitch_multiplier = 4.0f;
+
+    // Input gains of the saturation stages in Process().
+    static constexpr float fuzz_drive = 2.0f;
+    static constexpr float fuzz_makeup_gain = 1.35f;
+    static constexpr float osc_wah_drive = 2.5f;
+    static constexpr float osc_body_drive = 1.6f;
+    static constexpr float voice_bus_drive = 1.45f;
+
 private:
+    // The tracking front end shared by Process() and Track(). Returns the
+    // gate state.
+    bool TrackInput(float dry_signal, float& dry_envelope)
+    {
+        lfo_value = lfo();
+
+        dry_envelope = envelope_follower(std::abs(dry_signal));
+        ConfigureGate(params.trigger_ratio);
+
+        const bool gate_state = params.gate_enabled ? gate(dry_envelope) : true;
+        gate_envelope = gate_ramp(gate_state ? 1.0f : 0.0f);
+        const bool onset = DetectOnset(dry_signal);
+        if (gate_state && params.onset_reacquire)
+        {
+            if (!gate_open)
+            {
+                reacquire_pending = true;
+            }
+            else if (onset)
+            {
+                Reacquire();
+            }
+        }
+        gate_open = gate_state;
+        input_envelope = dry_envelope;
+
+        if (--prefilter_countdown <= 0)
+        {
+            prefilter_countdown = prefilter_update_samples;
+            ConfigurePrefilter();
+        }
+
+        const float input_edge = DetectInputRisingEdge(dry_signal, gate_state);
+        float vco_edge = DetectVcoRisingEdge();
+        if (UpdateFll(input_edge, gate_state))
+        {
+            // The VCO was just lined up with this input edge.
+            vco_edge = input_edge;
+        }
+        UpdatePll(input_edge, vco_edge, gate_state);
+
+        if (params.resynthesis)
+        {
+            resynthesizer.Track(dry_signal);
+        }
+        return gate_state;
+    }
+
+    // Flip-flop stages for the octaves of the sub interval, at least one.
+    int DividerStages() const
+    {
+        const float octaves = -std::log2(std::max(params.sub_pitch_multiplier, 0.125f));
+        return std::max(1, static_cast<int>(std::lround(octaves)));
+    }
+
+    void ApplyHarmonizerParams()
+    {
+        harmonizer.SetRatio(main_voice, params.main_pitch_multiplier);
+        harmonizer.SetShape(main_voice, params.wave_shape);
+        harmonizer.SetRatio(sub_voice, params.sub_pitch_multiplier);
+        harmonizer.SetShape(sub_voice, params.sub_wave_shape);
+        for (int i = 0; i < params.harmony_voice_count; ++i)
+        {
+            harmonizer.SetRatio(first_harmony_voice + i, params.harmony_ratios[i]);
+            harmonizer.SetShape(first_harmony_voice + i, params.wave_shape);
+        }
+        harmonizer.SetDivider(sub_voice, main_voice, params.flip_flop_divider ? DividerStages() : 0);
+        // Chord mode leaves the main voice to the poly tracker.
+        max_master_frequency = params.poly_tracking
+            ? max_frequency_hz
+            : max_frequency_hz / params.main_pitch_multiplier;
+        poly_tracker.SetRatio(params.main_pitch_multiplier);
+        poly_tracker.SetShape(params.wave_shape);
+        resynthesizer.SetHarmonics(static_cast<size_t>(params.resynthesis_harmonics));
+    }
+
+    // Converts a time constant to the coefficient of a one-pole smoother,
+    // x += (target - x) * coefficient, at the current sample rate.
+    float SmoothingCoefficient(float time_constant_s) const
+    {
+        return 1.0f - std::exp(-sample_period / time_constant_s);
+    }
+
+    void UpdateRateCoefficients()
+    {
+        input_dc_pole = std::exp(-2.0f * std::numbers::pi_v<float> * input_dc_block_hz * sample_period);
+        vco_settle_open = SmoothingCoefficient(vco_settle_s);
+        vco_settle_closed = SmoothingCoefficient(vco_release_s);
+        phase_error_release = 1.0f - SmoothingCoefficient(phase_error_release_s);
+        integrator_release = 1.0f - SmoothingCoefficient(integrator_release_s);
+        glide_slew_min = SmoothingCoefficient(glide_time_slow_s);
+        glide_slew_max = SmoothingCoefficient(glide_time_fast_s);
+        min_period_samples = sample_rate / max_frequency_hz;
+        max_period_samples = sample_rate / min_frequency_hz;
+        noise_max_hold_samples = noise_max_hold_s * sample_rate;
+        prefilter_update_samples = std::max(1, static_cast<int>(std::lround(prefilter_update_s * sample_rate)));
+        onset_peak_release = 1.0f - SmoothingCoefficient(onset_peak_release_s);
+        onset_average_coefficient = SmoothingCoefficient(onset_average_s);
+        onset_holdoff_samples = static_cast<int>(std::lround(onset_holdoff_s * sample_rate));
+    }
+
+    void UpdateLoopCoefficients()
+    {
+        // SetParams() runs every control tick, morphs included, but these
+        // only change with the tuning menu or the sample rate.
+        const std::array<float, 6> inputs{
+            params.pll_kp_hz,
+            params.pll_ki_hz,
+            params.pll_error_filter_alpha,
+            params.pll_integrator_limit_hz,
+            params.glide_follow_s,
+            sample_rate,
+        };
+        if (inputs == loop_coefficient_inputs)
+        {
+            return;
+        }
+        loop_coefficient_inputs = inputs;
+
+        const auto coefficients = DiscretizeLoop(LoopGains{
+            params.pll_kp_hz,
+            params.pll_ki_hz,
+            params.pll_error_filter_alpha,
+            params.pll_integrator_limit_hz,
+        }, sample_rate);
+        error_filter_coefficient = coefficients.error_filter_coefficient;
+        integrator_step = coefficients.integrator_step;
+        glide_target_follow_slew = SmoothingCoefficient(params.glide_follow_s);
+    }
+
     void ConfigureGate(float trigger_ratio)
     {
         const float trigger = trigger_mapping(trigger_ratio);
@@ -202,25 +540,186 @@ private:
         gate.release_threshold(q::lin_to_db(trigger) - 12_dB);
     }
 
-    bool DetectInputRisingEdge(float dry_signal, bool gate_open)
+    // Wide open until the first lock of a note so acquisition is not
+    // delayed, then gliding down to just above the measured pitch until the
+    // gate closes. The VCO edge is delayed by the filter's phase lag at that
+    // pitch, so narrowing it doesn't disturb the locked phase.
+    // Runs every prefilter_update_s.
+    void ConfigurePrefilter()
+    {
+        prefilter_tracking = prefilter_tracking
+            || (Locked() && std::abs(filtered_phase_error) < prefilter_engage_error);
+
+        if (params.input_prefilter && prefilter_tracking)
+        {
+            // Narrowing glides over a few pitch periods so the loop can follow.
+            const float target = std::clamp(
+                measured_frequency * prefilter_margin, min_frequency_hz, prefilter_open_hz);
+            const float slew = std::min(
+                prefilter_corner_slew_max,
+                measured_frequency * prefilter_update_s / prefilter_glide_periods);
+            prefilter_corner += (target - prefilter_corner) * slew;
+        }
+        else
+        {
+            prefilter_corner = prefilter_open_hz;
+        }
+        prefilter.configNormalized(prefilter_corner * sample_period, prefilter_q);
+
+        const float ratio = measured_frequency / prefilter_corner;
+        const float lag = std::atan2(ratio / prefilter_q, 1.0f - (ratio * ratio));
+        prefilter_lag_cycles = params.input_prefilter
+            ? lag / (2.0f * std::numbers::pi_v<float>)
+            : 0.0f;
+    }
+
+    // Pick transients: the peak of the input's slope jumps well above its
+    // recent average. A string that is still ringing keeps the gate open, so
+    // this is what marks a new note. The slope favours the pick's high
+    // frequencies, and the slow peak release rides over the ripple of low
+    // notes.
+    bool DetectOnset(float dry_signal)
+    {
+        const float slope = std::abs(dry_signal - onset_prev_sample);
+        onset_prev_sample = dry_signal;
+        onset_peak = std::max(slope, onset_peak * onset_peak_release);
+        onset_average += (onset_peak - onset_average) * onset_average_coefficient;
+
+        if (onset_holdoff > 0)
+        {
+            --onset_holdoff;
+            return false;
+        }
+        if (onset_peak > onset_floor && onset_peak > (onset_average * onset_ratio))
+        {
+            onset_holdoff = onset_holdoff_samples;
+            return true;
+        }
+        return false;
+    }
+
+    // Starts over on a new note. The integrator's share of the frequency
+    // moves to the FLL, so the VCO doesn't jump, the phase state is cleared
+    // so there is nothing to unwind, and the prefilter reopens. The next
+    // measured period restarts the FLL history and the VCO phase.
+    void Reacquire()
+    {
+        if (Locked())
+        {
+            RememberFrequency(measured_frequency);
+        }
+
+        fll_frequency = std::clamp(fll_frequency + pll_integrator, 0.0f, max_frequency_hz);
+        pll_integrator = 0.0f;
+        filtered_phase_error = 0.0f;
+        pfd_held_error = 0.0f;
+        pfd_input_latch = false;
+        pfd_vco_latch = false;
+        pfd_pair_samples = 0.0f;
+        lock_count = 0;
+        prefilter_tracking = false;
+        candidate_period = 0.0f;
+        reacquire_pending = true;
+    }
+
+    // Most recent first. A pitch close to an entry refreshes it.
+    void RememberFrequency(float frequency_hz)
+    {
+        size_t slot = recent_frequencies.size() - 1;
+        for (size_t i = 0; i < recent_frequencies.size(); ++i)
+        {
+            if (std::abs(recent_frequencies[i] - frequency_hz) < (frequency_hz * lock_tolerance))
+            {
+                slot = i;
+                break;
+            }
+        }
+        for (size_t i = slot; i > 0; --i)
+        {
+            recent_frequencies[i] = recent_frequencies[i - 1];
+        }
+        recent_frequencies[0] = frequency_hz;
+    }
+
+    // The cached pitch closest to a single period measurement, or 0.
+    float RecallFrequency(float frequency_hz) const
+    {
+        float best = 0.0f;
+        float best_error = frequency_hz * cache_match_tolerance;
+        for (const float cached : recent_frequencies)
+        {
+            const float error = std::abs(cached - frequency_hz);
+            if (cached > 0.0f && error < best_error)
+            {
+                best = cached;
+                best_error = error;
+            }
+        }
+        return best;
+    }
+
+    // Jumps the VCO to a new note's pitch, with its edge on the input edge
+    // that just completed the first period, so the phase loop starts from
+    // zero error. vco_phase only clocks the phase detector, so the jump is
+    // not heard.
+    void SyncVco(float input_edge, float frequency_hz, float period)
+    {
+        fll_frequency = std::clamp(frequency_hz - free_run_frequency_hz, 0.0f, max_frequency_hz);
+        vco_frequency = std::clamp(frequency_hz, 0.0f, max_frequency_hz);
+        pll_integrator = 0.0f;
+        filtered_phase_error = 0.0f;
+
+        if (params.quadrature_detector)
+        {
+            // The detector's own zero is wherever the analytic phase is now.
+            vco_phase = hilbert.PhaseCycles() + prefilter_lag_cycles;
+            vco_phase -= std::floor(vco_phase);
+        }
+        else
+        {
+            const float edge_phase = 0.5f + prefilter_lag_cycles;
+            vco_phase = edge_phase - (input_edge * vco_frequency * sample_period);
+            vco_phase -= std::floor(vco_phase);
+        }
+        vco_edge_armed = false;
+        pfd_pair_samples = period;
+    }
+
+    // Edge detectors return where in the current sample interval the edge
+    // fell, 0 at the previous sample to 1 at this one, or no_edge.
+    float DetectInputRisingEdge(float dry_signal, bool gate_open)
     {
         if (!gate_open)
         {
             input_high = false;
-            return false;
+            // The averaging window flushes itself with the zero error fed
+            // to it while the gate is closed.
+            hilbert.Reset();
+            return no_edge;
         }
 
         // Light conditioning before edge extraction reduces chatter on guitar input.
-        input_hp = (dry_signal - input_prev_sample) + (input_hp * 0.995f);
-        input_prev_sample = dry_signal;
+        prefilter.update(dry_signal);
+        const float conditioned = params.input_prefilter ? prefilter.lowPass() : dry_signal;
+        const float previous_hp = input_hp;
+        input_hp = (conditioned - input_prev_sample) + (input_hp * input_dc_pole);
+        input_prev_sample = conditioned;
+        if (params.quadrature_detector)
+        {
+            hilbert.Process(input_hp);
+        }
 
         const float threshold = edge_threshold_mapping(params.trigger_ratio);
-        bool rising_edge = false;
+        float rising_edge = no_edge;
 
         if (!input_high && input_hp > threshold)
         {
             input_high = true;
-            rising_edge = true;
+            // Linear interpolation of the threshold crossing.
+            const float rise = input_hp - previous_hp;
+            rising_edge = (rise > 0.0f)
+                ? std::clamp((threshold - previous_hp) / rise, 0.0f, 1.0f)
+                : 1.0f;
         }
         else if (input_high && input_hp < -threshold)
         {
@@ -230,58 +729,245 @@ private:
         return rising_edge;
     }
 
-    bool DetectVcoRisingEdge()
+    float DetectVcoRisingEdge()
     {
         // Keep PLL detector locked to control oscillator frequency.
         const float source_frequency = vco_frequency;
-        const float phase_step = source_frequency / sample_rate;
+        const float phase_step = source_frequency * sample_period;
 
+        const float edge_phase = 0.5f + prefilter_lag_cycles;
+
+        // One edge per cycle, even if the lag compensation moves the edge
+        // point past the phase after it already fired.
         const float next_phase = vco_phase + phase_step;
-        const bool edge = (vco_phase < 0.5f) && (next_phase >= 0.5f);
-        return edge;
+        if (vco_edge_armed && (vco_phase < edge_phase) && (next_phase >= edge_phase))
+        {
+            vco_edge_armed = false;
+            return (edge_phase - vco_phase) / phase_step;
+        }
+        return no_edge;
     }
 
-    void UpdatePll(bool input_edge, bool vco_edge, bool gate_open)
+    // Period-counting frequency detector. Measures the time between input
+    // edges to sub-sample precision and pulls the VCO straight to the
+    // measured frequency, so the PFD only has to clean up phase. Returns
+    // true when a new note's first period re-phased the VCO.
+    bool UpdateFll(float input_edge, bool gate_open)
     {
+        ++samples_since_input_edge;
+
         if (!gate_open)
         {
-            pfd_input_latch = false;
-            pfd_vco_latch = false;
-            filtered_phase_error *= 0.99f;
-            pll_integrator *= 0.998f;
+            if (Locked())
+            {
+                RememberFrequency(measured_frequency);
+            }
+            input_edge_valid = false;
+            input_periods = {};
+            candidate_period = 0.0f;
+            prefilter_tracking = false;
+            fll_frequency *= integrator_release;
+            lock_count = 0;
+            return false;
         }
 
-        if (input_edge)
+        if (input_edge == no_edge)
         {
-            pfd_input_latch = true;
+            return false;
         }
 
-        if (vco_edge)
+        const float period = (samples_since_input_edge - last_input_edge) + input_edge;
+        samples_since_input_edge = 0;
+        last_input_edge = input_edge;
+        if (!input_edge_valid)
         {
-            pfd_vco_latch = true;
+            input_edge_valid = true;
+            return false;
         }
 
-        if (pfd_input_latch && pfd_vco_latch)
+        if (period < min_period_samples || period > max_period_samples)
         {
+            return false;
+        }
+
+        // A new note needs two matching periods in a row, as the pick's
+        // transient adds edges of its own, or one that matches a pitch
+        // locked recently. A locked loop that sees the same away from its
+        // pitch is looking at a legato note change; a single odd period is
+        // ignored, as the median below would.
+        bool new_note = false;
+        if (reacquire_pending || (params.onset_reacquire && Locked()))
+        {
+            const bool deviates = reacquire_pending
+                || std::abs((period * measured_frequency / sample_rate) - 1.0f) > legato_tolerance;
+            if (!deviates)
+            {
+                candidate_period = 0.0f;
+            }
+            else
+            {
+                const float cached = reacquire_pending ? RecallFrequency(sample_rate / period) : 0.0f;
+                const bool confirmed = (cached > 0.0f)
+                    || (candidate_period > 0.0f && std::abs((period / candidate_period) - 1.0f) < lock_tolerance);
+                candidate_period = period;
+                if (!confirmed)
+                {
+                    return false;
+                }
+
+                if (!reacquire_pending)
+                {
+                    Reacquire();
+                }
+                reacquire_pending = false;
+                new_note = true;
+
+                // The history restarts from the new note, and if it matches
+                // a recent pitch that counts towards the lock.
+                const float seed_period = (cached > 0.0f) ? (sample_rate / cached) : period;
+                input_periods = {seed_period, seed_period, seed_period};
+                SyncVco(input_edge, sample_rate / seed_period, seed_period);
+                lock_count = (cached > 0.0f) ? (lock_periods - 2) : 0;
+            }
+        }
+
+        if (!new_note)
+        {
+            // Median of the last three periods rides out a single missed or
+            // extra edge.
+            input_periods = {input_periods[1], input_periods[2], period};
+        }
+        const float a = input_periods[0];
+        const float b = input_periods[1];
+        const float c = input_periods[2];
+        const float median = std::max(std::min(a, b), std::min(std::max(a, b), c));
+        if (median <= 0.0f)
+        {
+            return false;
+        }
+
+        // Compare against the loop's static frequency rather than the VCO,
+        // which also carries the proportional phase correction.
+        const float measured_hz = sample_rate / median;
+        measured_frequency = measured_hz;
+        const float error_hz = measured_hz - (free_run_frequency_hz + fll_frequency + pll_integrator);
+        // Full gain pulls in within a few periods; once locked the phase
+        // loop does the fine tracking and the FLL only trims.
+        const float gain = Locked() ? (params.fll_gain * fll_locked_gain_ratio) : params.fll_gain;
+        fll_frequency += gain * error_hz;
+        fll_frequency = std::clamp(fll_frequency, 0.0f, max_frequency_hz);
+
+        // The phase detector updates once per input cycle, so the phase loop
+        // gains come down with the pitch to keep low notes stable.
+        loop_scale = std::min(1.0f, measured_hz / loop_scale_reference_hz);
+
+        if (std::abs(error_hz) < (measured_hz * lock_tolerance))
+        {
+            lock_count = std::min(lock_count + 1, lock_periods);
+        }
+        else
+        {
+            lock_count = 0;
+        }
+        return new_note;
+    }
+
+    void CompletePfdPair(float lead_samples)
+    {
+        pfd_last_interval = std::clamp(pfd_pair_samples, 1.0f, max_period_samples);
+        pfd_held_error = std::clamp(lead_samples / pfd_last_interval, -1.0f, 1.0f);
+        pfd_pair_samples = 0.0f;
+        pfd_input_latch = false;
+        pfd_vco_latch = false;
+    }
+
+    void UpdatePll(float input_edge, float vco_edge, bool gate_open)
+    {
+        if (!gate_open)
+        {
+            pfd_input_latch = false;
+            pfd_vco_latch = false;
+            pfd_held_error = 0.0f;
+            filtered_phase_error *= phase_error_release;
+            pll_integrator *= integrator_release;
+        }
+        else if (reacquire_pending)
+        {
+            // Until a new note's first period lines the VCO up, the phase
+            // detector would only compare it against the old note.
             pfd_input_latch = false;
             pfd_vco_latch = false;
+            pfd_held_error = 0.0f;
+            input_edge = no_edge;
+            vco_edge = no_edge;
+        }
+
+        // Sampled phase detector. When the second edge of a pair arrives,
+        // the fractional time between the two, over the time since the
+        // previous pair, is held as the error until the next pair. That is
+        // the mean of the classic latch detector's pulses without their
+        // once-per-cycle ripple.
+        ++pfd_pair_samples;
+        if (input_edge != no_edge && vco_edge != no_edge && !pfd_input_latch && !pfd_vco_latch)
+        {
+            CompletePfdPair(vco_edge - input_edge);
+        }
+        else if (input_edge != no_edge && !pfd_input_latch)
+        {
+            if (pfd_vco_latch)
+            {
+                CompletePfdPair(-(pfd_pending_samples + input_edge));
+            }
+            else
+            {
+                pfd_input_latch = true;
+                pfd_pending_samples = -input_edge;
+            }
+        }
+        else if (vco_edge != no_edge && !pfd_vco_latch)
+        {
+            if (pfd_input_latch)
+            {
+                CompletePfdPair(pfd_pending_samples + vco_edge);
+            }
+            else
+            {
+                pfd_vco_latch = true;
+                pfd_pending_samples = -vco_edge;
+            }
+        }
+        pfd_pending_samples += 1.0f;
+
+        // An edge still waiting for its partner raises the error as it
+        // goes, so a stalled VCO still gets pushed.
+        float raw_phase_error = gate_open ? pfd_held_error : 0.0f;
+        const float pending = std::min(pfd_pending_samples / pfd_last_interval, 1.0f);
+        if (pfd_input_latch)
+        {
+            raw_phase_error = std::max(raw_phase_error, pending);
+        }
+        else if (pfd_vco_latch)
+        {
+            raw_phase_error = std::min(raw_phase_error, -pending);
         }
 
-        const float raw_phase_error =
-            (pfd_input_latch ? 1.0f : 0.0f) - (pfd_vco_latch ? 1.0f : 0.0f);
+        if (params.quadrature_detector)
+        {
+            raw_phase_error = AverageOverPeriod(gate_open && !reacquire_pending ? QuadraturePhaseError() : 0.0f);
+        }
 
-        filtered_phase_error += params.pll_error_filter_alpha * (raw_phase_error - filtered_phase_error);
-        pll_integrator += (filtered_phase_error * params.pll_ki_hz);
+        filtered_phase_error += error_filter_coefficient * (raw_phase_error - filtered_phase_error);
+        pll_integrator += (filtered_phase_error * integrator_step * loop_scale * loop_scale);
         pll_integrator = std::clamp(
             pll_integrator,
             -params.pll_integrator_limit_hz,
             params.pll_integrator_limit_hz);
 
         const float target_frequency = gate_open
-            ? (free_run_frequency_hz + (filtered_phase_error * params.pll_kp_hz) + pll_integrator)
+            ? (free_run_frequency_hz + fll_frequency + (filtered_phase_error * params.pll_kp_hz * loop_scale) + pll_integrator)
             : 0.0f;
 
-        const float settle = gate_open ? 0.01f : 0.004f;
+        const float settle = gate_open ? vco_settle_open : vco_settle_closed;
         vco_frequency += (target_frequency - vco_frequency) * settle;
         vco_frequency = std::clamp(vco_frequency, 0.0f, max_frequency_hz);
 
@@ -303,7 +989,56 @@ private:
         glide_target_frequency = std::clamp(glide_target_frequency, 0.0f, max_frequency_hz);
     }
 
-    float GenerateMainOscillator()
+    // Phase of the input's analytic signal less the VCO phase, in cycles
+    // and wrapped to half a cycle either way. Any fixed offset between the
+    // two, from the prefilter or the all-pass chains, is taken up by the
+    // integrator. Below the edge threshold the phase is only noise, and
+    // the error is zero.
+    float QuadraturePhaseError() const
+    {
+        const float threshold = edge_threshold_mapping(params.trigger_ratio);
+        if (hilbert.Magnitude2() < threshold * threshold)
+        {
+            return 0.0f;
+        }
+        const float error = hilbert.PhaseCycles() + prefilter_lag_cycles - vco_phase;
+        return error - std::round(error);
+    }
+
+    // Running mean of the quadrature error over one VCO period. Harmonics
+    // make the analytic phase wobble at multiples of the pitch, which a
+    // window of exactly one period cancels. The window follows the VCO a
+    // sample at a time and covers the fraction of a sample at its far end.
+    float AverageOverPeriod(float error)
+    {
+        const float period = std::clamp(
+            sample_rate / std::max(vco_frequency, min_frequency_hz),
+            1.0f,
+            static_cast<float>(quadrature_window_size - 2));
+        const auto length = static_cast<size_t>(period);
+
+        // The sum covers the last quadrature_length errors, and one more
+        // once the new one is in.
+        constexpr size_t mask = quadrature_window_size - 1;
+        quadrature_position = (quadrature_position + 1) & mask;
+        quadrature_history[quadrature_position] = error;
+        quadrature_sum += error;
+        ++quadrature_length;
+        while (quadrature_length > length)
+        {
+            quadrature_sum -= quadrature_history[(quadrature_position - quadrature_length + 1) & mask];
+            --quadrature_length;
+        }
+        while (quadrature_length < length)
+        {
+            ++quadrature_length;
+            quadrature_sum += quadrature_history[(quadrature_position - quadrature_length + 1) & mask];
+        }
+        const float oldest = quadrature_history[(quadrature_position - quadrature_length) & mask];
+        return (quadrature_sum + ((period - static_cast<float>(length)) * oldest)) / period;
+    }
+
+    void AdvanceOscillator()
     {
         const bool instant_snap = params.glide_speed >= 0.999f;
         if (instant_snap)
@@ -324,139 +1059,274 @@ private:
         }
 
         glide_frequency = std::clamp(glide_frequency, 0.0f, max_frequency_hz);
-        const float main_frequency = std::clamp(
-            glide_frequency * params.main_pitch_multiplier,
-            0.0f,
-            max_frequency_hz);
-
-        phase.set(main_frequency, sample_rate);
-        const float signal = wave_synth.compensated(phase);
-        phase++;
+
+        // Every voice is an integer multiple of one master phase, so the main,
+        // sub and harmony voices stay locked to each other. The main voice
+        // stops at max_frequency_hz; the master stops with it, so the other
+        // voices keep their intervals to it.
+        const float vibrato = 1.0f + (lfo_value * params.lfo_pitch_depth);
+        harmonizer.SetFrequency(std::min(glide_frequency * vibrato, max_master_frequency));
+        harmonizer.Advance();
         AdvancePhases();
-        return params.use_vco_phase_output
-            ? RenderShapedPhase(output_phase, params.wave_shape)
-            : signal;
     }
 
-    float GenerateSubOscillatorVoice()
+    float GenerateMainOscillator()
     {
-        const float sub_frequency = std::clamp(
-            vco_frequency * params.sub_pitch_multiplier,
-            0.0f,
-            max_frequency_hz);
-
+        if (params.resynthesis)
+        {
+            return resynthesizer.Render(harmonizer.VoicePhase(main_voice));
+        }
         if (params.use_vco_phase_output)
         {
-            sub_vco_phase += sub_frequency / sample_rate;
-            if (sub_vco_phase >= 1.0f)
-            {
-                sub_vco_phase -= 1.0f;
-            }
-            return RenderShapedPhase(sub_vco_phase, params.sub_wave_shape);
+            return harmonizer(main_voice);
         }
-
-        sub_phase.set(sub_frequency, sample_rate);
-        const float sub = sub_wave_synth.compensated(sub_phase);
-        sub_phase++;
-        return sub;
+        return wave_synth.compensated(q::phase{harmonizer.VoicePhase(main_voice)});
     }
 
-    void AdvancePhases()
+    float GenerateSubOscillatorVoice()
     {
-        vco_phase += vco_frequency / sample_rate;
-        if (vco_phase >= 1.0f)
+        if (params.use_vco_phase_output || params.flip_flop_divider)
         {
-            vco_phase -= 1.0f;
+            return harmonizer(sub_voice);
         }
+        return sub_wave_synth.compensated(q::phase{harmonizer.VoicePhase(sub_voice)});
+    }
 
-        output_phase += (glide_frequency * params.main_pitch_multiplier) / sample_rate;
-        if (output_phase >= 1.0f)
+    float GenerateHarmonyVoices()
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < params.harmony_voice_count; ++i)
         {
-            output_phase -= 1.0f;
+            sum += harmonizer(first_harmony_voice + i);
         }
+        return sum / static_cast<float>(params.harmony_voice_count);
     }
 
-    float RenderShapedPhase(float phase_value, float shape) const
+    float GenerateNoiseVoice()
     {
-        const float ph = phase_value - std::floor(phase_value);
-        const float pulse = (ph < 0.2f) ? 1.0f : -1.0f;
-        const float square = (ph < 0.5f) ? 1.0f : -1.0f;
-        const float triangle = 1.0f - (4.0f * std::abs(ph - 0.5f));
-        const float saw = (2.0f * ph) - 1.0f;
+        // Pitch-tracked sample-and-hold: the hold clock runs at a fixed
+        // multiple of the tracked pitch, so the noise follows the playing.
+        const float hold_hz = glide_frequency * noise_hold_ratio;
+        const float duration = (hold_hz > 0.0f)
+            ? std::min(sample_rate / hold_hz, noise_max_hold_samples)
+            : noise_max_hold_samples;
+        noise_synth.setSampleDuration(duration);
+        return noise_synth();
+    }
 
-        const float s = std::clamp(shape, 0.0f, 3.0f);
-        if (s < 1.0f)
-        {
-            return std::lerp(pulse, square, s);
-        }
-        if (s < 2.0f)
+    void AdvancePhases()
+    {
+        vco_phase += vco_frequency * sample_period;
+        if (vco_phase >= 1.0f)
         {
-            return std::lerp(square, triangle, s - 1.0f);
+            vco_phase -= 1.0f;
+            vco_edge_armed = true;
         }
-        return std::lerp(triangle, saw, s - 2.0f);
     }
 
     static constexpr float min_frequency_hz = 30.0f;
-    static constexpr float max_frequency_hz = 2400.0f;
     static constexpr float free_run_frequency_hz = 1.0f;
+    static constexpr float no_edge = -1.0f;
+    static constexpr float lock_tolerance = 0.03f;
+    static constexpr int lock_periods = 3;
+    static constexpr float fll_locked_gain_ratio = 0.1f;
+    static constexpr float loop_scale_reference_hz = 400.0f;
+    static constexpr float prefilter_margin = 1.2f;
+    static constexpr float prefilter_open_hz = 4000.0f;
+    static constexpr float prefilter_q = 0.707f;
+    static constexpr float prefilter_update_s = 0.001f;
+    static constexpr float prefilter_engage_error = 0.05f;
+    static constexpr float prefilter_corner_slew_max = 0.1f;
+    static constexpr float prefilter_glide_periods = 4.0f;
+    static constexpr float onset_peak_release_s = 0.05f;
+    static constexpr float onset_average_s = 0.03f;
+    static constexpr float onset_ratio = 2.0f;
+    static constexpr float onset_floor = 0.002f;
+    static constexpr float onset_holdoff_s = 0.05f;
+    static constexpr float legato_tolerance = 0.04f;
+    static constexpr float cache_match_tolerance = 0.06f;
+    static constexpr size_t frequency_cache_size = 8;
+    // A period of min_frequency_hz at 48 kHz. Higher rates cut the lowest
+    // notes' averaging window short.
+    static constexpr size_t quadrature_window_size = 2048;
+
+    static constexpr int main_voice = 0;
+    static constexpr int sub_voice = 1;
+    static constexpr int first_harmony_voice = 2;
 
     static constexpr LogMapping trigger_mapping{0.0001f, 0.05f, 0.4f};
     static constexpr LogMapping fuzz_threshold_mapping{0.0008f, 0.08f};
-    static constexpr LinearMapping noise_duration_mapping{1.0f, 120.0f};
     static constexpr LogMapping edge_threshold_mapping{0.001f, 0.06f};
 
     Params params{};
-    float sample_rate = 48000.0f;
+    float sample_rate = loop_reference_rate;
+    float sample_period = 1.0f / loop_reference_rate;
     float gate_envelope = 0.0f;
+    bool gate_open = false;
+    float input_envelope = 0.0f;
     float vco_phase = 0.0f;
-    float output_phase = 0.0f;
-    float sub_vco_phase = 0.0f;
+    bool vco_edge_armed = true;
+    float lfo_value = 0.0f;
     float vco_frequency = free_run_frequency_hz;
     float glide_frequency = free_run_frequency_hz;
     float glide_target_frequency = free_run_frequency_hz;
+    float max_master_frequency = max_frequency_hz;
+    std::array<float, 6> loop_coefficient_inputs{};
     float input_prev_sample = 0.0f;
     float input_hp = 0.0f;
     bool input_high = false;
+    HilbertPair hilbert;
+    std::array<float, quadrature_window_size> quadrature_history{};
+    size_t quadrature_position = 0;
+    size_t quadrature_length = 0;
+    float quadrature_sum = 0.0f;
 
     bool pfd_input_latch = false;
     bool pfd_vco_latch = false;
+    float pfd_pending_samples = 0.0f;
+    float pfd_pair_samples = 0.0f;
+    float pfd_last_interval = 1.0f;
+    float pfd_held_error = 0.0f;
     float filtered_phase_error = 0.0f;
     float pll_integrator = 0.0f;
 
-    static constexpr float glide_slew_min = 0.0000625f;
-    static constexpr float glide_slew_max = 0.02f;
-    static constexpr float glide_target_follow_slew = 0.006f;
+    float fll_frequency = 0.0f;
+    std::array<float, 3> input_periods{};
+    uint32_t samples_since_input_edge = 0;
+    float last_input_edge = 0.0f;
+    bool input_edge_valid = false;
+    int lock_count = 0;
+    float loop_scale = 1.0f;
+    float measured_frequency = 0.0f;
+    int prefilter_countdown = 0;
+    bool prefilter_tracking = false;
+    float prefilter_corner = prefilter_open_hz;
+    float prefilter_lag_cycles = 0.0f;
+    float onset_prev_sample = 0.0f;
+    float onset_peak = 0.0f;
+    float onset_average = 0.0f;
+    int onset_holdoff = 0;
+    bool reacquire_pending = false;
+    float candidate_period = 0.0f;
+    std::array<float, frequency_cache_size> recent_frequencies{};
+
+    // Per-sample coefficients, derived from the times below for the
+    // current sample rate.
+    float input_dc_pole = 0.995f;
+    float vco_settle_open = 0.01f;
+    float vco_settle_closed = 0.004f;
+    float phase_error_release = 0.99f;
+    float integrator_release = 0.998f;
+    float glide_slew_min = 0.0000625f;
+    float glide_slew_max = 0.02f;
+    float glide_target_follow_slew = 0.006f;
+    float error_filter_coefficient = 0.0035f;
+    float integrator_step = 0.25f;
+    float min_period_samples = 20.0f;
+    float max_period_samples = 1600.0f;
+    float noise_max_hold_samples = 120.0f;
+    int prefilter_update_samples = 48;
+    float onset_peak_release = 0.9996f;
+    float onset_average_coefficient = 0.0007f;
+    int onset_holdoff_samples = 2400;
+
+    static constexpr float input_dc_block_hz = 38.0f;
+    static constexpr float vco_settle_s = 0.00207f;
+    static constexpr float vco_release_s = 0.0052f;
+    static constexpr float phase_error_release_s = 0.00207f;
+    static constexpr float integrator_release_s = 0.0104f;
+    static constexpr float glide_time_slow_s = 0.333f;
+    static constexpr float glide_time_fast_s = 0.00103f;
+    static constexpr float gate_ramp_s = 0.0026f;
+    static constexpr float output_mute_ramp_s = 0.0083f;
+    static constexpr float noise_max_hold_s = 0.0025f;
     static constexpr float glide_lock_deadband_hz = 0.35f;
     static constexpr float mute_frequency_hz = 0.7f;
-    static constexpr float fuzz_drive = 2.0f;
-    static constexpr float fuzz_makeup_gain = 1.35f;
+    static constexpr float noise_hold_ratio = 4.0f;
     static constexpr float voice_additive_mix = 0.55f;
     static constexpr float voice_pairwise_mix = 0.32f;
     static constexpr float voice_triple_mix = 0.13f;
-    static constexpr float voice_bus_drive = 1.45f;
     static constexpr float osc_wah_min_hz = 110.0f;
     static constexpr float osc_wah_max_hz = 3200.0f;
-    static constexpr float osc_wah_tracking_ratio = 1.15f;
     static constexpr float osc_wah_q_min = 1.2f;
-    static constexpr float osc_wah_q_max = 6.0f;
     static constexpr float osc_wah_bp_mix = 0.72f;
     static constexpr float osc_gate_floor = 0.35f;
     static constexpr float osc_fuzz_inject = 0.55f;
     static constexpr float osc_wah_mix = 0.88f;
-    static constexpr float osc_wah_drive = 2.5f;
-    static constexpr float osc_body_drive = 1.6f;
     static constexpr float osc_fx_mix = 0.95f;
 
     Fuzz fuzz;
     NoiseSynth noise_synth;
     SvFilter cross_wah_filter;
+    SvFilter prefilter;
     WaveSynth wave_synth;
     WaveSynth sub_wave_synth;
+    Harmonizer harmonizer;
+    PolyTracker poly_tracker;
+    Resynthesizer resynthesizer;
+    TempoLfo lfo;
 
     q::peak_envelope_follower envelope_follower{10_ms, sample_rate};
     q::noise_gate gate{-120_dB};
     LinearRamp gate_ramp{0.0f, 0.008f};
     LinearRamp output_mute_ramp{0.0f, 0.0025f};
-    q::phase_iterator phase;
-    q::phase_iterator sub_phase;
 };
+
+// Interpolates between two derived parameter sets, the PLL::Params
+// counterpart of EffectState's blended(). Continuous values are lerped.
+// Voices that are on at either end stay on during the morph, with levels
+// fading from zero, so nothing switches mid-transition. Other flags flip at
+// the midpoint.
+constexpr PLL::Params blended(
+    const PLL::Params& p1, const PLL::Params& p2, float ratio)
+{
+    using std::lerp;
+    if (ratio <= 0.0f) return p1;
+    if (ratio >= 1.0f) return p2;
+
+    const auto& nearest = (ratio < 0.5f) ? p1 : p2;
+    PLL::Params p = nearest;
+    p.master_level = lerp(p1.master_level, p2.master_level, ratio);
+    p.fuzz_level = lerp(p1.fuzz_level, p2.fuzz_level, ratio);
+    p.osc_level = lerp(p1.osc_level, p2.osc_level, ratio);
+    p.sub_level = lerp(
+        p1.sub_enabled ? p1.sub_level : 0.0f,
+        p2.sub_enabled ? p2.sub_level : 0.0f,
+        ratio);
+    p.noise_level = lerp(
+        p1.noise_mode ? p1.noise_level : 0.0f,
+        p2.noise_mode ? p2.noise_level : 0.0f,
+        ratio);
+    p.harmony_level = lerp(
+        (p1.harmony_voice_count > 0) ? p1.harmony_level : 0.0f,
+        (p2.harmony_voice_count > 0) ? p2.harmony_level : 0.0f,
+        ratio);
+    p.trigger_ratio = lerp(p1.trigger_ratio, p2.trigger_ratio, ratio);
+    p.wave_shape = lerp(p1.wave_shape, p2.wave_shape, ratio);
+    p.sub_wave_shape = lerp(p1.sub_wave_shape, p2.sub_wave_shape, ratio);
+    p.main_pitch_multiplier = lerp(p1.main_pitch_multiplier, p2.main_pitch_multiplier, ratio);
+    p.sub_pitch_multiplier = lerp(p1.sub_pitch_multiplier, p2.sub_pitch_multiplier, ratio);
+    // The loop gains and glide_follow_s come from the tuning both ends
+    // share, so they stay at nearest's and the loop is not re-designed.
+    p.glide_speed = lerp(p1.glide_speed, p2.glide_speed, ratio);
+    p.fll_gain = lerp(p1.fll_gain, p2.fll_gain, ratio);
+    p.wah_tracking_ratio = lerp(p1.wah_tracking_ratio, p2.wah_tracking_ratio, ratio);
+    p.wah_q_max = lerp(p1.wah_q_max, p2.wah_q_max, ratio);
+    p.lfo_pitch_depth = lerp(p1.lfo_pitch_depth, p2.lfo_pitch_depth, ratio);
+    p.lfo_wah_depth = lerp(p1.lfo_wah_depth, p2.lfo_wah_depth, ratio);
+    p.lfo_level_depth = lerp(p1.lfo_level_depth, p2.lfo_level_depth, ratio);
+    p.sub_enabled = p1.sub_enabled || p2.sub_enabled;
+    p.noise_mode = p1.noise_mode || p2.noise_mode;
+    p.harmony_voice_count = std::max(p1.harmony_voice_count, p2.harmony_voice_count);
+    for (int i = 0; i < static_cast<int>(p.harmony_ratios.size()); ++i)
+    {
+        // A voice only one end plays keeps that end's ratio rather than
+        // sweeping in from the other end's unused one.
+        const bool in1 = i < p1.harmony_voice_count;
+        const bool in2 = i < p2.harmony_voice_count;
+        p.harmony_ratios[i] = (in1 && in2)
+            ? lerp(p1.harmony_ratios[i], p2.harmony_ratios[i], ratio)
+            : (in1 ? p1.harmony_ratios[i] : p2.harmony_ratios[i]);
+    }
+    return p;
+}
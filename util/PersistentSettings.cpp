@@ -1,12 +1,20 @@
 #include "PersistentSettings.h"
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <type_traits>
 
 namespace
 {
 
+// QSPI addresses are 32-bit; going through uintptr_t keeps host builds happy.
+uint32_t flashAddress(const void* pointer)
+{
+    return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(pointer));
+}
+
 uint32_t crc32(const uint8_t *data, size_t length)
 {
     constexpr uint32_t poly = 0x82f63b78;
@@ -41,12 +49,140 @@ struct Slot
 
 static_assert(std::is_trivially_copyable_v<Slot>);
 
+// QSPI erases whole sectors, so every region starts on one and fills a
+// whole number of them; erasing one region never touches another.
+constexpr size_t flash_sector_size = 4096;
+
 constexpr size_t slot_count = 512;
 constexpr size_t flash_size = slot_count * sizeof(Slot);
-uint8_t DSY_QSPI_BSS alignas(Slot) flash[flash_size];
-const Slot* slots = reinterpret_cast<Slot *>(flash);
+static_assert(flash_size % flash_sector_size == 0, "settings region must be whole sectors");
+
+// Slots of the first release, before the tuning: same flag and check, at
+// their own stride from the start of the settings region.
+struct LegacySlot
+{
+    uint32_t header;
+    struct
+    {
+        uint32_t version;
+        uint8_t preset_valid;
+        uint8_t effect_enabled;
+        uint8_t reserved0;
+        uint8_t reserved1;
+        StoredControlState preset_state;
+    } settings;
+    uint32_t check;
+
+    uint32_t calculateCheck() const
+    {
+        const auto data = reinterpret_cast<const uint8_t*>(this);
+        const auto size = sizeof(*this) - sizeof(check);
+        return crc32(data, size);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<LegacySlot>);
+static_assert(sizeof(LegacySlot) == 44);
+static_assert(slot_count * sizeof(LegacySlot) <= flash_size);
+
+struct LogEntry
+{
+    static constexpr uint32_t empty = 0xFFFFFFFF;
+    static constexpr uint32_t flag = 0x0BADB10C;
+
+    uint32_t header;
+    OverrunRecord record;
+    uint32_t check;
+
+    uint32_t calculateCheck() const
+    {
+        const auto data = reinterpret_cast<const uint8_t*>(this);
+        const auto size = sizeof(*this) - sizeof(check);
+        return crc32(data, size);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<LogEntry>);
+
+constexpr size_t log_size = 2 * flash_sector_size;
+constexpr size_t log_entry_count = log_size / sizeof(LogEntry);
+static_assert(log_size % flash_sector_size == 0, "overrun log must be whole sectors");
+
+struct alignas(flash_sector_size) IrSlot
+{
+    static constexpr uint32_t flag = 0x1CAB1DE5;
+
+    uint32_t header;
+    uint32_t length;
+    float sample_rate;
+    uint32_t check;
+    float taps[impulse_response_max_taps];
+};
+
+static_assert(std::is_trivially_copyable_v<IrSlot>);
+static_assert(sizeof(IrSlot) % flash_sector_size == 0, "impulse response slots must be whole sectors");
+
+// One object, so the regions keep this order and alignment whatever the
+// linker does with separate variables. The settings come first, at the
+// start of the section, where the first release kept its slots.
+struct Regions
+{
+    alignas(flash_sector_size) uint8_t settings[flash_size];
+    alignas(flash_sector_size) uint8_t log[log_size];
+    alignas(IrSlot) uint8_t impulse_responses[impulse_response_slot_count * sizeof(IrSlot)];
+};
+
+static_assert(offsetof(Regions, settings) % flash_sector_size == 0);
+static_assert(offsetof(Regions, log) % flash_sector_size == 0);
+static_assert(offsetof(Regions, impulse_responses) % flash_sector_size == 0);
+static_assert(alignof(Regions) % flash_sector_size == 0);
+
+Regions DSY_QSPI_BSS regions;
+const Slot* slots = reinterpret_cast<Slot *>(regions.settings);
+const LogEntry* log_entries = reinterpret_cast<LogEntry *>(regions.log);
+const IrSlot* ir_slots = reinterpret_cast<IrSlot *>(regions.impulse_responses);
+const LegacySlot* legacy_slots = reinterpret_cast<LegacySlot *>(regions.settings);
 size_t current_slot = slot_count;
 
+// Over the used taps only, so a short response checks quickly.
+uint32_t irCheck(uint32_t length, float sample_rate, const float* taps)
+{
+    uint32_t fields[2] = {length, 0};
+    static_assert(sizeof(float) == sizeof(uint32_t));
+    std::memcpy(&fields[1], &sample_rate, sizeof(float));
+    return crc32(reinterpret_cast<const uint8_t*>(fields), sizeof(fields))
+        ^ crc32(reinterpret_cast<const uint8_t*>(taps), length * sizeof(float));
+}
+
+// The newest slot of the first release, with the tuning left at its
+// defaults. The next save then erases the region, as it would when full.
+bool loadLegacySettings(Settings& settings)
+{
+    for (auto i = slot_count; i--;)
+    {
+        const auto& slot = legacy_slots[i];
+        if (slot.header != Slot::flag) { continue; }
+        if (slot.check != slot.calculateCheck()) { continue; }
+        settings = Settings();
+        settings.preset_valid = slot.settings.preset_valid;
+        settings.effect_enabled = slot.settings.effect_enabled;
+        settings.preset_state = slot.settings.preset_state;
+        current_slot = slot_count;
+        return true;
+    }
+    return false;
+}
+
+size_t logEnd()
+{
+    size_t end = 0;
+    while (end < log_entry_count && log_entries[end].header != LogEntry::empty)
+    {
+        ++end;
+    }
+    return end;
+}
+
 } // namespace
 
 
@@ -58,9 +194,20 @@ Settings loadSettings()
         if (slot.header != Slot::flag) { continue; }
         if (slot.check != slot.calculateCheck()) { continue; }
         current_slot = i;
-        return slot.settings;
+        Settings settings = slot.settings;
+        if (settings.version < 2)
+        {
+            // No loop design stored: the first release's slots are the
+            // legacy ones, and nothing else wrote a usable tuning.
+            settings.tuning = Tuning{};
+            settings.version = Settings::current_version;
+        }
+        return settings;
     }
-    return Settings();
+
+    Settings settings;
+    loadLegacySettings(settings);
+    return settings;
 }
 
 void saveSettings(daisy::QSPIHandle& qspi, const Settings& settings)
@@ -75,7 +222,7 @@ void saveSettings(daisy::QSPIHandle& qspi, const Settings& settings)
 
         if (current_slot >= slot_count)
         {
-            const auto address = reinterpret_cast<uint32_t>(flash);
+            const auto address = flashAddress(regions.settings);
             const auto size = static_cast<uint32_t>(flash_size);
             const auto result = qspi.Erase(address, address+size);
             if (result != daisy::QSPIHandle::Result::OK)
@@ -92,8 +239,7 @@ void saveSettings(daisy::QSPIHandle& qspi, const Settings& settings)
         };
         slot.check = slot.calculateCheck();
 
-        const auto address =
-            reinterpret_cast<uint32_t>(slots + current_slot);
+        const auto address = flashAddress(slots + current_slot);
         const auto size = static_cast<uint32_t>(sizeof(slot));
         const auto data = reinterpret_cast<uint8_t*>(&slot);
         const auto result = qspi.Write(address, size, data);
@@ -103,3 +249,90 @@ void saveSettings(daisy::QSPIHandle& qspi, const Settings& settings)
         }
     }
 }
+
+size_t overrunRecordCount()
+{
+    return logEnd();
+}
+
+bool loadOverrunRecord(size_t index, OverrunRecord& record)
+{
+    if (index >= log_entry_count) { return false; }
+    const auto& entry = log_entries[index];
+    if (entry.header != LogEntry::flag) { return false; }
+    if (entry.check != entry.calculateCheck()) { return false; }
+    record = entry.record;
+    return true;
+}
+
+void appendOverrunRecord(daisy::QSPIHandle& qspi, const OverrunRecord& record)
+{
+    auto end = logEnd();
+    if (end >= log_entry_count)
+    {
+        // Full: start over rather than keep stale history.
+        const auto address = flashAddress(regions.log);
+        const auto size = static_cast<uint32_t>(log_size);
+        if (qspi.Erase(address, address+size) != daisy::QSPIHandle::Result::OK)
+        {
+            return;
+        }
+        end = 0;
+    }
+
+    LogEntry entry{
+        .header = LogEntry::flag,
+        .record = record,
+        .check = 0
+    };
+    entry.check = entry.calculateCheck();
+
+    const auto address = flashAddress(log_entries + end);
+    const auto size = static_cast<uint32_t>(sizeof(entry));
+    const auto data = reinterpret_cast<uint8_t*>(&entry);
+    qspi.Write(address, size, data);
+}
+
+bool loadImpulseResponse(size_t slot, ImpulseResponse& response)
+{
+    if (slot >= impulse_response_slot_count) { return false; }
+    const auto& stored = ir_slots[slot];
+    if (stored.header != IrSlot::flag) { return false; }
+    if (stored.length == 0 || stored.length > impulse_response_max_taps) { return false; }
+    if (stored.check != irCheck(stored.length, stored.sample_rate, stored.taps)) { return false; }
+    response.taps = stored.taps;
+    response.length = stored.length;
+    response.sample_rate = stored.sample_rate;
+    return true;
+}
+
+bool storeImpulseResponse(daisy::QSPIHandle& qspi, size_t slot, const float* taps, size_t length, float sample_rate)
+{
+    if (slot >= impulse_response_slot_count || length == 0 || length > impulse_response_max_taps)
+    {
+        return false;
+    }
+
+    const auto& stored = ir_slots[slot];
+    const auto address = flashAddress(&stored);
+    const auto size = static_cast<uint32_t>(sizeof(IrSlot));
+    if (qspi.Erase(address, address+size) != daisy::QSPIHandle::Result::OK)
+    {
+        return false;
+    }
+
+    // Taps first and the header last, so an interrupted store reads back as
+    // an empty slot.
+    const auto taps_address = flashAddress(stored.taps);
+    const auto taps_size = static_cast<uint32_t>(length * sizeof(float));
+    auto taps_data = reinterpret_cast<uint8_t*>(const_cast<float*>(taps));
+    if (qspi.Write(taps_address, taps_size, taps_data) != daisy::QSPIHandle::Result::OK)
+    {
+        return false;
+    }
+
+    uint32_t header[4] = {IrSlot::flag, static_cast<uint32_t>(length), 0, irCheck(static_cast<uint32_t>(length), sample_rate, taps)};
+    std::memcpy(&header[2], &sample_rate, sizeof(float));
+    const auto header_data = reinterpret_cast<uint8_t*>(header);
+    return qspi.Write(address, sizeof(header), header_data) == daisy::QSPIHandle::Result::OK;
+}
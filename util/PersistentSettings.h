@@ -4,6 +4,8 @@
 
 #include <per/qspi.h>
 
+#include <util/Tuning.h>
+
 struct StoredControlState
 {
     std::array<float, 6> knobs{};
@@ -12,13 +14,56 @@ struct StoredControlState
 
 struct Settings
 {
-    uint32_t version = 1;
+    // 1: the first release, without the tuning, in shorter slots.
+    // 2: the tuning holds a loop design in place of Kp, Ki and the
+    // integrator limit.
+    static constexpr uint32_t current_version = 2;
+
+    uint32_t version = current_version;
     uint8_t preset_valid = 0;
     uint8_t effect_enabled = 1;
-    uint8_t reserved0 = 0;
-    uint8_t reserved1 = 0;
+    // 0 = 48 kHz, 1 = 32 kHz low CPU, 2 = 96 kHz low latency.
+    uint8_t audio_rate_mode = 0;
+    // Main voice, see ApplyVoiceMode(). Older settings only ever stored 0
+    // or 1.
+    uint8_t voice_mode = 0;
     StoredControlState preset_state{};
+    Tuning tuning{};
 };
 
 Settings loadSettings();
 void saveSettings(daisy::QSPIHandle& qspi, const Settings& settings);
+
+// Append-only log of audio deadline misses, kept in its own flash sectors.
+struct OverrunRecord
+{
+    uint16_t session = 0;
+    uint16_t reserved = 0;
+    uint32_t uptime_s = 0;
+    uint32_t config_key = 0;
+    uint32_t budget_cycles = 0;
+    uint32_t worst_cycles = 0;
+    uint32_t overruns = 0;
+    uint32_t near_misses = 0;
+    uint32_t late_starts = 0;
+};
+
+// Impulse responses for the cabinet convolver, one per slot in their own
+// flash sectors. Loaded responses point straight into the memory-mapped
+// flash.
+constexpr size_t impulse_response_slot_count = 4;
+constexpr size_t impulse_response_max_taps = 2048;
+
+struct ImpulseResponse
+{
+    const float* taps = nullptr;
+    size_t length = 0;
+    float sample_rate = 0.0f;
+};
+
+bool loadImpulseResponse(size_t slot, ImpulseResponse& response);
+bool storeImpulseResponse(daisy::QSPIHandle& qspi, size_t slot, const float* taps, size_t length, float sample_rate);
+
+size_t overrunRecordCount();
+bool loadOverrunRecord(size_t index, OverrunRecord& record);
+void appendOverrunRecord(daisy::QSPIHandle& qspi, const OverrunRecord& record);
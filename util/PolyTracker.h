@@ -0,0 +1,316 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+#include <q/support/literals.hpp>
+
+#include <util/Harmonizer.h>
+#include <util/SvFilter.h>
+
+// Chord tracking: a bank of band-pass filters, one per string's first
+// position in standard tuning, each with its own pitch tracker and
+// oscillator voice.
+//
+// A strummed chord hands the PLL's single edge detector one edge train per
+// string, all interleaved, and zero crossings stop meaning anything. Here
+// every band runs an adaptive notch filter instead, which slides onto the
+// strongest partial in its band even with the neighbouring strings
+// leaking in. A band is locked while its notch removes most of the band's
+// power, and its voice then plays at that pitch, at its share of the
+// loudest band's level. A band that repeats a louder band's pitch, or one
+// of its first overtones, stays silent; an octave in a chord goes with it,
+// but is already covered by the lower voice.
+//
+// Nothing in the bands needs more than a few hundred hertz, so they run on
+// the input decimated by decimation. The voices render at the full rate.
+//
+// State is one array per quantity with a lane per band, and each stage runs
+// across all lanes before the next, as straight-line arithmetic over
+// contiguous arrays that the compiler unrolls and schedules as a batch.
+class PolyTracker
+{
+public:
+    static constexpr size_t bands = 6;
+    static constexpr int decimation = 8;
+
+    // Open strings in standard tuning, low to high.
+    static constexpr std::array<float, bands> open_string_hz{
+        82.41f, 110.0f, 146.83f, 196.0f, 246.94f, 329.63f};
+
+    // Each band is centred on the first position of its string, open to
+    // the 5th fret, where neighbouring strings are at least a fourth apart
+    // and most chords are played. Its notch can follow a note from two
+    // semitones below the open string (drop tunings) up to the 14th fret.
+    static constexpr float band_centre_ratio = 1.155f;
+    static constexpr float band_q = 3.0f;
+    static constexpr float min_ratio = 0.89f;
+    static constexpr float max_ratio = 2.25f;
+
+    // Notch pole radius, about 10 Hz wide at 48 kHz, and its normalized
+    // adaptation step.
+    static constexpr float notch_radius = 0.995f;
+    static constexpr float notch_step = 0.01f;
+    static constexpr float power_s = 0.02f;
+
+    // Share of the band's power left after the notch to take or hold a
+    // lock.
+    static constexpr float lock_residual = 0.35f;
+    static constexpr float unlock_residual = 0.5f;
+    static constexpr float min_level = 0.002f;
+    // Pitches within this of each other or of an overtone are the same.
+    static constexpr float pitch_tolerance = 0.03f;
+    static constexpr float voice_slew_s = 0.003f;
+
+    void Init(float sample_rate)
+    {
+        using namespace cycfi::q::literals;
+        constexpr auto pi = std::numbers::pi_v<float>;
+
+        _sample_rate = sample_rate;
+        const float band_rate = sample_rate / decimation;
+        _anti_alias[0].config(1200_Hz, sample_rate, 0.54f);
+        _anti_alias[1].config(1200_Hz, sample_rate, 1.31f);
+
+        for (size_t b = 0; b < bands; ++b)
+        {
+            const float centre = open_string_hz[b] * band_centre_ratio / band_rate;
+            const float k = std::tan(pi * centre);
+            _k[b] = k;
+            _c1[b] = (1.0f / band_q) + k;
+            _c2[b] = 1.0f / (1.0f + (k / band_q) + (k * k));
+
+            _home_a[b] = -2.0f * std::cos(2.0f * pi * centre);
+            _min_a[b] = -2.0f * std::cos(2.0f * pi * open_string_hz[b] * min_ratio / band_rate);
+            _max_a[b] = -2.0f * std::cos(2.0f * pi * open_string_hz[b] * max_ratio / band_rate);
+        }
+        _power_coefficient = 1.0f - std::exp(-1.0f / (power_s * band_rate));
+        _voice_slew = 1.0f - std::exp(-1.0f / (voice_slew_s * sample_rate));
+        Reset();
+    }
+
+    void Reset()
+    {
+        _countdown = 0;
+        _s1 = {};
+        _s2 = {};
+        _s3 = {};
+        _s4 = {};
+        _band = {};
+        _a = _home_a;
+        _n1 = {};
+        _n2 = {};
+        _notch_power = {};
+        _band_power = {};
+        _residual_power = {};
+        _omega = {};
+        _locked = {};
+        _silent = {};
+        _target = {};
+        _amplitude = {};
+        _phase = {};
+        _increment = {};
+    }
+
+    // Voice pitch relative to the tracked strings.
+    void SetRatio(float ratio)
+    {
+        _ratio = ratio;
+    }
+
+    void SetShape(float shape)
+    {
+        _shape = Harmonizer::ShapeMix(shape);
+    }
+
+    bool Locked(size_t band) const
+    {
+        return _locked[band];
+    }
+
+    // True for a locked band that is playing its voice.
+    bool Sounding(size_t band) const
+    {
+        return !_silent[band];
+    }
+
+    float Frequency(size_t band) const
+    {
+        constexpr auto pi = std::numbers::pi_v<float>;
+        return _omega[band] * _sample_rate / (2.0f * pi * decimation);
+    }
+
+    // Runs the bands without rendering.
+    void Track(float input)
+    {
+        _anti_alias[0].update(input);
+        _anti_alias[1].update(_anti_alias[0].lowPass());
+        if (--_countdown > 0)
+        {
+            return;
+        }
+        _countdown = decimation;
+
+        Filter(_anti_alias[1].lowPass());
+        Notch();
+        Assign();
+    }
+
+    float Process(float input)
+    {
+        Track(input);
+        return Render();
+    }
+
+private:
+    static constexpr float phase_range = 4294967296.0f;
+
+    using Lanes = std::array<float, bands>;
+
+    // Two band-pass sections per band, each normalized to unity gain at
+    // the centre. Same state variable filter as SvFilter, one lane per
+    // band.
+    void Filter(float input)
+    {
+        constexpr float q_inv = 1.0f / band_q;
+        for (size_t b = 0; b < bands; ++b)
+        {
+            const float hp1 = (input - (_c1[b] * _s1[b]) - _s2[b]) * _c2[b];
+            const float bp1 = (_k[b] * hp1) + _s1[b];
+            _s1[b] = (_k[b] * hp1) + bp1;
+            const float lp1 = (_k[b] * bp1) + _s2[b];
+            _s2[b] = (_k[b] * bp1) + lp1;
+            const float section = bp1 * q_inv;
+
+            const float hp2 = (section - (_c1[b] * _s3[b]) - _s4[b]) * _c2[b];
+            const float bp2 = (_k[b] * hp2) + _s3[b];
+            _s3[b] = (_k[b] * hp2) + bp2;
+            const float lp2 = (_k[b] * bp2) + _s4[b];
+            _s4[b] = (_k[b] * bp2) + lp2;
+            _band[b] = bp2 * q_inv;
+        }
+    }
+
+    // Constrained-pole notch, 1 + a z^-1 + z^-2 over the same with the
+    // poles pulled in to notch_radius, with a normalized gradient step on
+    // a = -2 cos(w) towards the frequency that minimizes its output.
+    void Notch()
+    {
+        constexpr float r = notch_radius;
+        for (size_t b = 0; b < bands; ++b)
+        {
+            const float x = _band[b];
+            const float s = x - (r * _a[b] * _n1[b]) - (r * r * _n2[b]);
+            const float e = s + (_a[b] * _n1[b]) + _n2[b];
+
+            _notch_power[b] += ((_n1[b] * _n1[b]) - _notch_power[b]) * _power_coefficient;
+            const float a = _a[b] - (notch_step * e * _n1[b] / (_notch_power[b] + 1e-9f));
+            _a[b] = std::clamp(a, _min_a[b], _max_a[b]);
+            _n2[b] = _n1[b];
+            _n1[b] = s;
+
+            _band_power[b] += ((x * x) - _band_power[b]) * _power_coefficient;
+            _residual_power[b] += ((e * e) - _residual_power[b]) * _power_coefficient;
+        }
+    }
+
+    // Lock state, voice pitch and level for every band.
+    void Assign()
+    {
+        constexpr auto pi = std::numbers::pi_v<float>;
+        constexpr float min_power = min_level * min_level;
+
+        float loudest = min_power;
+        const float increment_scale = _ratio * phase_range / (2.0f * pi * decimation);
+        for (size_t b = 0; b < bands; ++b)
+        {
+            const float threshold = _locked[b] ? unlock_residual : lock_residual;
+            _locked[b] = (_band_power[b] > min_power)
+                && (_residual_power[b] < (_band_power[b] * threshold));
+            loudest = std::max(loudest, _band_power[b]);
+
+            _omega[b] = std::acos(std::clamp(-0.5f * _a[b], -1.0f, 1.0f));
+            _increment[b] = static_cast<uint32_t>(std::min(_omega[b] * increment_scale, phase_range * 0.5f));
+        }
+
+        // Neighbouring ranges overlap, so a string can lock two bands, and
+        // the upper harmonics of a low string reach the bands above it.
+        for (size_t b = 0; b < bands; ++b)
+        {
+            _silent[b] = !_locked[b];
+            for (size_t other = 0; (other < bands) && !_silent[b]; ++other)
+            {
+                if (other == b || !_locked[other])
+                {
+                    continue;
+                }
+                const float ratio = _omega[b] / _omega[other];
+                const float harmonic = std::round(ratio);
+                const bool quieter = (_band_power[b] < _band_power[other])
+                    || ((_band_power[b] == _band_power[other]) && (b > other));
+                _silent[b] = quieter && (harmonic >= 1.0f) && (harmonic <= 3.0f)
+                    && (std::abs(ratio - harmonic) < (harmonic * pitch_tolerance));
+            }
+            _target[b] = _silent[b] ? 0.0f : std::sqrt(_band_power[b] / loudest);
+        }
+    }
+
+    float Render()
+    {
+        float total = 0.0f;
+        for (size_t b = 0; b < bands; ++b)
+        {
+            _amplitude[b] += (_target[b] - _amplitude[b]) * _voice_slew;
+            total += _amplitude[b];
+        }
+
+        float sum = 0.0f;
+        for (size_t b = 0; b < bands; ++b)
+        {
+            _phase[b] += _increment[b];
+            sum += Harmonizer::ShapedSample(_shape, _phase[b]) * _amplitude[b];
+        }
+        // Chords come out about as loud as a single voice.
+        return sum / std::sqrt(std::max(total, 1.0f));
+    }
+
+    std::array<SvFilter, 2> _anti_alias{};
+    int _countdown = 0;
+
+    Lanes _k{};
+    Lanes _c1{};
+    Lanes _c2{};
+    Lanes _s1{};
+    Lanes _s2{};
+    Lanes _s3{};
+    Lanes _s4{};
+    Lanes _band{};
+
+    Lanes _home_a{};
+    Lanes _min_a{};
+    Lanes _max_a{};
+    Lanes _a{};
+    Lanes _n1{};
+    Lanes _n2{};
+    Lanes _notch_power{};
+    Lanes _band_power{};
+    Lanes _residual_power{};
+    Lanes _omega{};
+    std::array<bool, bands> _locked{};
+    std::array<bool, bands> _silent{};
+
+    Lanes _target{};
+    Lanes _amplitude{};
+    std::array<uint32_t, bands> _phase{};
+    std::array<uint32_t, bands> _increment{};
+
+    float _sample_rate = 48000.0f;
+    Harmonizer::Mix _shape{};
+    float _ratio = 1.0f;
+    float _power_coefficient = 0.008f;
+    float _voice_slew = 0.007f;
+};
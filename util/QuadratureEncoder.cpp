@@ -0,0 +1,73 @@
+#include "QuadratureEncoder.h"
+
+#include <array>
+
+namespace
+{
+
+// Indexed by (previous state << 2) | state, with the state as (A << 1) | B.
+// Transitions that skip a state are ambiguous and count as nothing.
+constexpr std::array<int8_t, 16> quadrature_steps{
+    0, -1, 1, 0,
+    1, 0, 0, -1,
+    -1, 0, 0, 1,
+    0, 1, -1, 0,
+};
+
+} // namespace
+
+void QuadratureEncoder::Init(daisy::Pin a, daisy::Pin b, daisy::Pin click)
+{
+    _a.pin = a;
+    _a.mode = DSY_GPIO_MODE_INPUT;
+    _a.pull = DSY_GPIO_PULLUP;
+    _b.pin = b;
+    _b.mode = DSY_GPIO_MODE_INPUT;
+    _b.pull = DSY_GPIO_PULLUP;
+    dsy_gpio_init(&_a);
+    dsy_gpio_init(&_b);
+    _click.Init(click);
+
+    _state = ReadState();
+    _steps = 0;
+    _read_steps = 0;
+
+    // TIM2 is the system clock behind GetUs() and GetTick().
+    daisy::TimerHandle::Config config;
+    config.periph = daisy::TimerHandle::Config::Peripheral::TIM_5;
+    config.dir = daisy::TimerHandle::Config::CounterDir::UP;
+    config.enable_irq = true;
+    _timer.Init(config);
+    _timer.SetPeriod((_timer.GetFreq() / sample_rate_hz) - 1);
+    _timer.SetCallback(OnTimer, this);
+    _timer.Start();
+}
+
+int QuadratureEncoder::Increment()
+{
+    // Only whole detents are taken; the rest waits for the next call.
+    const int32_t pending = _steps - _read_steps;
+    const int32_t detents = pending / steps_per_detent;
+    _read_steps += detents * steps_per_detent;
+    return static_cast<int>(detents);
+}
+
+void QuadratureEncoder::OnTimer(void* data)
+{
+    static_cast<QuadratureEncoder*>(data)->Sample();
+}
+
+void QuadratureEncoder::Sample()
+{
+    const uint8_t state = ReadState();
+    if (state != _state)
+    {
+        _steps = _steps + quadrature_steps[(_state << 2) | state];
+        _state = state;
+    }
+}
+
+uint8_t QuadratureEncoder::ReadState() const
+{
+    return static_cast<uint8_t>((dsy_gpio_read(&_a) << 1) | dsy_gpio_read(&_b));
+}
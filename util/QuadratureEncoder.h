@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+#include <daisy_seed.h>
+
+// Rotary encoder decoded from a timer interrupt.
+//
+// The encoder pins on the Terrarium (D6, D5) are not channels of one timer,
+// so the STM32's hardware encoder mode can't count them. Instead a timer
+// samples both phases at sample_rate_hz, well above the edge rate of a fast
+// spin, and a full quadrature state table turns every transition into a
+// quarter step. Contact bounce is a step forward and back, so it cancels
+// out, and the control loop only reads the accumulated count: no step is
+// lost however long a tick takes.
+class QuadratureEncoder
+{
+public:
+    static constexpr uint32_t sample_rate_hz = 4000;
+    static constexpr int32_t steps_per_detent = 4;
+
+    void Init(daisy::Pin a, daisy::Pin b, daisy::Pin click);
+
+    // Call from the control loop.
+    void Debounce() { _click.Debounce(); }
+
+    // Detents turned since the last call, clockwise positive.
+    int Increment();
+
+    bool Pressed() const { return _click.Pressed(); }
+    bool RisingEdge() const { return _click.RisingEdge(); }
+
+private:
+    static void OnTimer(void* data);
+    void Sample();
+    uint8_t ReadState() const;
+
+    dsy_gpio _a{};
+    dsy_gpio _b{};
+    daisy::Switch _click;
+    daisy::TimerHandle _timer;
+
+    uint8_t _state = 0;
+    volatile int32_t _steps = 0;
+    int32_t _read_steps = 0;
+};
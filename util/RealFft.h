@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <numbers>
+#include <utility>
+
+// Real FFT of a fixed power-of-two size, single precision throughout.
+//
+// Runs a complex FFT of half the size on the even and odd samples packed
+// as real and imaginary parts, then splits the result, as CMSIS-DSP's
+// arm_rfft_fast_f32 does. Twiddles and the bit reversal order are tables
+// built once, so the transforms themselves are only loads, multiply-adds
+// and stores.
+//
+// Spectra are packed in size floats: DC and Nyquist (both real) in [0] and
+// [1], then the real and imaginary parts of bins 1 to size/2 - 1.
+// Inverse(Forward(x)) is x scaled by size.
+template <size_t size>
+class RealFft
+{
+public:
+    static_assert(size >= 8 && (size & (size - 1)) == 0, "size must be a power of two");
+
+    RealFft()
+    {
+        constexpr auto pi = std::numbers::pi_v<double>;
+        for (size_t k = 0; k < half; ++k)
+        {
+            // The complex stage only needs the first half of its own
+            // twiddles, which are every other one of these.
+            const double angle = -2.0 * pi * static_cast<double>(k) / static_cast<double>(size);
+            _split_cos[k] = static_cast<float>(std::cos(angle));
+            _split_sin[k] = static_cast<float>(std::sin(angle));
+        }
+
+        size_t bits = 0;
+        while ((size_t{1} << bits) < half)
+        {
+            ++bits;
+        }
+        for (size_t i = 0; i < half; ++i)
+        {
+            size_t reversed = 0;
+            for (size_t b = 0; b < bits; ++b)
+            {
+                reversed |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            _bit_reversed[i] = static_cast<unsigned short>(reversed);
+        }
+    }
+
+    // in and out may be the same buffer.
+    void Forward(const float* in, float* out) const
+    {
+        if (in != out)
+        {
+            for (size_t i = 0; i < size; ++i)
+            {
+                out[i] = in[i];
+            }
+        }
+        Complex(out, false);
+
+        const float dc = out[0] + out[1];
+        const float nyquist = out[0] - out[1];
+        out[0] = dc;
+        out[1] = nyquist;
+
+        for (size_t k = 1; k <= half / 2; ++k)
+        {
+            const size_t m = half - k;
+            const float zr = out[2 * k];
+            const float zi = out[(2 * k) + 1];
+            const float cr = out[2 * m];
+            const float ci = -out[(2 * m) + 1];
+
+            // Even and odd sample spectra, from Z[k] and conj(Z[half - k]).
+            const float er = 0.5f * (zr + cr);
+            const float ei = 0.5f * (zi + ci);
+            const float odd_r = 0.5f * (zi - ci);
+            const float odd_i = -0.5f * (zr - cr);
+
+            const float wr = _split_cos[k];
+            const float wi = _split_sin[k];
+            const float tr = (odd_r * wr) - (odd_i * wi);
+            const float ti = (odd_r * wi) + (odd_i * wr);
+
+            out[2 * k] = er + tr;
+            out[(2 * k) + 1] = ei + ti;
+            // X[half - k] = conj(E[k] - W^k O[k]).
+            out[2 * m] = er - tr;
+            out[(2 * m) + 1] = -(ei - ti);
+        }
+    }
+
+    // in and out may be the same buffer.
+    void Inverse(const float* in, float* out) const
+    {
+        const float dc = in[0];
+        const float nyquist = in[1];
+
+        for (size_t k = 1; k <= half / 2; ++k)
+        {
+            const size_t m = half - k;
+            const float xr = in[2 * k];
+            const float xi = in[(2 * k) + 1];
+            const float cr = in[2 * m];
+            const float ci = -in[(2 * m) + 1];
+
+            const float er = xr + cr;
+            const float ei = xi + ci;
+            const float dr = xr - cr;
+            const float di = xi - ci;
+
+            // O[k] = (X[k] - conj(X[half - k])) W^-k.
+            const float wr = _split_cos[k];
+            const float wi = -_split_sin[k];
+            const float odd_r = (dr * wr) - (di * wi);
+            const float odd_i = (dr * wi) + (di * wr);
+
+            // Z[k] = E[k] + i O[k], Z[half - k] = conj(E[k]) + i conj(O[k]).
+            out[2 * k] = er - odd_i;
+            out[(2 * k) + 1] = ei + odd_r;
+            out[2 * m] = er + odd_i;
+            out[(2 * m) + 1] = odd_r - ei;
+        }
+        out[0] = dc + nyquist;
+        out[1] = dc - nyquist;
+
+        Complex(out, true);
+    }
+
+private:
+    static constexpr size_t half = size / 2;
+
+    // In-place radix-2 decimation in time over half complex points.
+    void Complex(float* data, bool inverse) const
+    {
+        for (size_t i = 0; i < half; ++i)
+        {
+            const size_t j = _bit_reversed[i];
+            if (j > i)
+            {
+                std::swap(data[2 * i], data[2 * j]);
+                std::swap(data[(2 * i) + 1], data[(2 * j) + 1]);
+            }
+        }
+
+        const float sign = inverse ? -1.0f : 1.0f;
+        for (size_t length = 2; length <= half; length *= 2)
+        {
+            const size_t stride = (2 * half) / length;
+            for (size_t start = 0; start < half; start += length)
+            {
+                for (size_t k = 0; k < length / 2; ++k)
+                {
+                    const float wr = _split_cos[k * stride];
+                    const float wi = sign * _split_sin[k * stride];
+                    float* a = data + (2 * (start + k));
+                    float* b = data + (2 * (start + k + (length / 2)));
+                    const float tr = (b[0] * wr) - (b[1] * wi);
+                    const float ti = (b[0] * wi) + (b[1] * wr);
+                    b[0] = a[0] - tr;
+                    b[1] = a[1] - ti;
+                    a[0] += tr;
+                    a[1] += ti;
+                }
+            }
+        }
+    }
+
+    std::array<float, half> _split_cos{};
+    std::array<float, half> _split_sin{};
+    std::array<unsigned short, half> _bit_reversed{};
+};
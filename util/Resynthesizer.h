@@ -0,0 +1,239 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+
+// Harmonic resynthesis: measures the first harmonics of the tracked pitch
+// in the input and plays them back on an additive voice, so the synth
+// follows the player's tone as well as the pitch.
+//
+// The analysis is a bank of Goertzel filters, one per harmonic, over
+// windows of a whole number of periods of the fundamental. Every harmonic
+// then falls exactly on its own bin and the others cancel out. Each
+// window is tuned to the fundamental when it starts, and the harmonic
+// levels are updated when it ends.
+//
+// The voice sums the harmonics off one phase, with sin(k x) from the
+// Chebyshev recurrence, at levels normalized so the total power stays that
+// of a full-scale sine. Loudness is left to the envelope follower.
+//
+// State is one array per quantity with a lane per harmonic, as in
+// PolyTracker. Analysis and rendering both cost a few multiply-adds per
+// harmonic per sample, and a window's end a square root per harmonic.
+class Resynthesizer
+{
+public:
+    static constexpr size_t max_harmonics = 16;
+
+    // Windows span whole periods and are at least this long.
+    static constexpr float window_s = 0.02f;
+    static constexpr float min_fundamental_hz = 30.0f;
+    // Harmonics above this share of the sample rate are left out of both
+    // the analysis and the voice.
+    static constexpr float max_harmonic_ratio = 0.45f;
+    // A window quieter than this keeps the previous levels, so the tone
+    // holds through a note's tail.
+    static constexpr float min_level = 0.002f;
+    static constexpr float level_slew_s = 0.005f;
+
+    void Init(float sample_rate)
+    {
+        constexpr auto pi = std::numbers::pi_v<float>;
+        _sample_rate = sample_rate;
+        _level_slew = 1.0f - std::exp(-1.0f / (level_slew_s * sample_rate));
+        for (size_t i = 0; i <= table_size; ++i)
+        {
+            _sine[i] = std::sin(2.0f * pi * static_cast<float>(i) / table_size);
+        }
+        Reset();
+    }
+
+    // Starts over from a plain sine.
+    void Reset()
+    {
+        _s1 = {};
+        _s2 = {};
+        _target = {};
+        _target[0] = 1.0f;
+        _level = _target;
+        _window_length = 0;
+        _window_position = 0;
+    }
+
+    void SetHarmonics(size_t count)
+    {
+        _count = std::clamp<size_t>(count, 1, max_harmonics);
+        for (size_t k = _count; k < max_harmonics; ++k)
+        {
+            _target[k] = 0.0f;
+            _level[k] = 0.0f;
+        }
+    }
+
+    // Control rate. The analysis follows analysis_hz from its next window
+    // on, and 0 holds the levels it has. voice_hz is the pitch the voice
+    // plays at, which only limits its harmonics.
+    void SetFundamental(float analysis_hz, float voice_hz)
+    {
+        _analysis_hz = analysis_hz;
+        const float limit = max_harmonic_ratio * _sample_rate;
+        _audible = (voice_hz > 0.0f)
+            ? std::clamp(static_cast<size_t>(limit / voice_hz), size_t{1}, _count)
+            : _count;
+    }
+
+    // Relative level of a harmonic, 0 for the fundamental.
+    float Level(size_t harmonic) const
+    {
+        return _target[harmonic];
+    }
+
+    void Track(float input)
+    {
+        if (_window_length == 0)
+        {
+            if (_analysis_hz < min_fundamental_hz)
+            {
+                return;
+            }
+            StartWindow();
+        }
+
+        for (size_t k = 0; k < _analysed; ++k)
+        {
+            const float s = input + (_coefficient[k] * _s1[k]) - _s2[k];
+            _s2[k] = _s1[k];
+            _s1[k] = s;
+        }
+
+        if (++_window_position >= _window_length)
+        {
+            Measure();
+            StartWindow();
+        }
+    }
+
+    // The voice at phase, a full cycle being 2^32.
+    float Render(uint32_t phase)
+    {
+        for (size_t k = 0; k < _count; ++k)
+        {
+            _level[k] += (_target[k] - _level[k]) * _level_slew;
+        }
+
+        const float sine = Sine(phase);
+        const float cosine = Sine(phase + quarter_cycle);
+
+        // sin((k + 1) x) = 2 cos(x) sin(k x) - sin((k - 1) x).
+        const float twice_cosine = 2.0f * cosine;
+        float previous = 0.0f;
+        float current = sine;
+        float sum = _level[0] * sine;
+        for (size_t k = 1; k < _audible; ++k)
+        {
+            const float next = (twice_cosine * current) - previous;
+            previous = current;
+            current = next;
+            sum += _level[k] * current;
+        }
+        return sum;
+    }
+
+    float Process(float input, uint32_t phase)
+    {
+        Track(input);
+        return Render(phase);
+    }
+
+private:
+    static constexpr int table_bits = 9;
+    static constexpr size_t table_size = size_t{1} << table_bits;
+    static constexpr uint32_t quarter_cycle = 0x40000000u;
+    static constexpr float fraction_scale = 1.0f / static_cast<float>(uint32_t{1} << (32 - table_bits));
+
+    using Lanes = std::array<float, max_harmonics>;
+
+    // Linear interpolation in a sine table, good to about 2e-5.
+    float Sine(uint32_t phase) const
+    {
+        const uint32_t index = phase >> (32 - table_bits);
+        const float fraction = static_cast<float>(phase & ((uint32_t{1} << (32 - table_bits)) - 1)) * fraction_scale;
+        return std::lerp(_sine[index], _sine[index + 1], fraction);
+    }
+
+    void StartWindow()
+    {
+        _s1 = {};
+        _s2 = {};
+        _window_position = 0;
+        _window_length = 0;
+        if (_analysis_hz < min_fundamental_hz)
+        {
+            return;
+        }
+
+        const float periods = std::ceil(window_s * _analysis_hz);
+        _window_length = static_cast<size_t>(std::lround(periods * _sample_rate / _analysis_hz));
+        _analysed = std::clamp(
+            static_cast<size_t>(max_harmonic_ratio * _sample_rate / _analysis_hz), size_t{1}, _count);
+
+        // Harmonic k sits in bin k * periods. 2 cos(k w) by the same
+        // recurrence as the voice, from one cosine per window.
+        constexpr auto pi = std::numbers::pi_v<float>;
+        const float first = 2.0f * std::cos(2.0f * pi * periods / static_cast<float>(_window_length));
+        float previous = 2.0f;
+        float current = first;
+        for (size_t k = 0; k < _analysed; ++k)
+        {
+            _coefficient[k] = current;
+            const float next = (first * current) - previous;
+            previous = current;
+            current = next;
+        }
+    }
+
+    // A harmonic of amplitude a on its bin ends a window of n samples with
+    // s1^2 + s2^2 - c s1 s2 = (a n / 2)^2.
+    void Measure()
+    {
+        const float scale = 2.0f / static_cast<float>(_window_length);
+        Lanes amplitude{};
+        float total = 0.0f;
+        for (size_t k = 0; k < _analysed; ++k)
+        {
+            const float power = (_s1[k] * _s1[k]) + (_s2[k] * _s2[k]) - (_coefficient[k] * _s1[k] * _s2[k]);
+            amplitude[k] = std::sqrt(std::max(power, 0.0f)) * scale;
+            total += amplitude[k] * amplitude[k];
+        }
+        if (total < (min_level * min_level))
+        {
+            return;
+        }
+
+        const float normalize = 1.0f / std::sqrt(total);
+        for (size_t k = 0; k < _count; ++k)
+        {
+            _target[k] = amplitude[k] * normalize;
+        }
+    }
+
+    Lanes _coefficient{};
+    Lanes _s1{};
+    Lanes _s2{};
+    Lanes _target{};
+    Lanes _level{};
+
+    std::array<float, table_size + 1> _sine{};
+    float _sample_rate = 48000.0f;
+    float _analysis_hz = 0.0f;
+    float _level_slew = 0.004f;
+    size_t _count = max_harmonics;
+    size_t _analysed = 0;
+    size_t _audible = max_harmonics;
+    size_t _window_length = 0;
+    size_t _window_position = 0;
+};
@@ -20,9 +20,15 @@ public:
     }
 
     void config(cycfi::q::frequency corner, float sample_rate, float q=0.707)
+    {
+        configNormalized(cycfi::q::as_float(corner) / sample_rate, q);
+    }
+
+    // Corner as a fraction of the sample rate, for callers that retune
+    // every sample and keep the sample period at hand.
+    void configNormalized(float f, float q=0.707)
     {
         constexpr auto pi = std::numbers::pi_v<float>;
-        const auto f = cycfi::q::as_float(corner) / sample_rate;
         assert(f <= 0.5); // fastertan expects input in [-pi/2, pi/2]
         const auto k = fastertan(pi * f);
 
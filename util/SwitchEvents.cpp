@@ -0,0 +1,187 @@
+#include "SwitchEvents.h"
+
+namespace
+{
+
+SwitchEvents* interrupt_target = nullptr;
+
+GPIO_TypeDef* gpioPort(daisy::Pin pin)
+{
+    // Seed pins only use ports A to G.
+    constexpr std::array<GPIO_TypeDef*, 7> ports{
+        GPIOA, GPIOB, GPIOC, GPIOD, GPIOE, GPIOF, GPIOG,
+    };
+    const auto port = static_cast<size_t>(pin.port);
+    return (port < ports.size()) ? ports[port] : nullptr;
+}
+
+IRQn_Type extiIrq(uint8_t line)
+{
+    switch (line)
+    {
+        case 0: return EXTI0_IRQn;
+        case 1: return EXTI1_IRQn;
+        case 2: return EXTI2_IRQn;
+        case 3: return EXTI3_IRQn;
+        case 4: return EXTI4_IRQn;
+        default: return (line < 10) ? EXTI9_5_IRQn : EXTI15_10_IRQn;
+    }
+}
+
+// Below the audio DMA interrupt, so an edge never delays a block.
+constexpr uint32_t exti_priority = 10;
+
+} // namespace
+
+void SwitchEvents::Add(SwitchEvent::Source source, uint8_t index, daisy::Pin pin, daisy::Switch& input)
+{
+    if (_input_count >= _inputs.size())
+    {
+        return;
+    }
+
+    auto& entry = _inputs[_input_count++];
+    entry.source = source;
+    entry.index = index;
+    entry.pin = pin;
+    entry.input = &input;
+    entry.interrupt = false;
+    entry.pressed = input.RawState();
+    entry.changed_us = daisy::System::GetUs();
+}
+
+void SwitchEvents::Start()
+{
+    interrupt_target = this;
+    __HAL_RCC_SYSCFG_CLK_ENABLE();
+
+    // An EXTI line serves one port at a time, so where pin numbers clash
+    // the stomps get the line.
+    uint16_t used_lines = 0;
+    for (size_t n = 0; n < 2 * _input_count; ++n)
+    {
+        auto& entry = _inputs[n % _input_count];
+        const bool stomp_pass = (n < _input_count);
+        if (stomp_pass != (entry.source == SwitchEvent::Source::Stomp))
+        {
+            continue;
+        }
+
+        const auto line_mask = static_cast<uint16_t>(1u << entry.pin.pin);
+        GPIO_TypeDef* port = gpioPort(entry.pin);
+        if (port == nullptr || (used_lines & line_mask) != 0)
+        {
+            continue;
+        }
+        used_lines |= line_mask;
+        entry.interrupt = true;
+
+        // Same input configuration as daisy::Switch, plus both edges.
+        GPIO_InitTypeDef init{};
+        init.Pin = line_mask;
+        init.Mode = GPIO_MODE_IT_RISING_FALLING;
+        init.Pull = GPIO_PULLUP;
+        init.Speed = GPIO_SPEED_FREQ_LOW;
+        HAL_GPIO_Init(port, &init);
+
+        const auto irq = extiIrq(entry.pin.pin);
+        HAL_NVIC_SetPriority(irq, exti_priority, 0);
+        HAL_NVIC_EnableIRQ(irq);
+    }
+}
+
+void SwitchEvents::Poll()
+{
+    const auto now_us = daisy::System::GetUs();
+    for (size_t i = 0; i < _input_count; ++i)
+    {
+        // The interrupt handler updates the same entry and queues.
+        daisy::ScopedIrqBlocker block_interrupts;
+        Update(_inputs[i], now_us);
+    }
+}
+
+bool SwitchEvents::Pressed(SwitchEvent::Source source, uint8_t index) const
+{
+    for (size_t i = 0; i < _input_count; ++i)
+    {
+        const auto& entry = _inputs[i];
+        if (entry.source == source && entry.index == index)
+        {
+            return entry.pressed;
+        }
+    }
+    return false;
+}
+
+void SwitchEvents::OnInterrupt(uint16_t gpio_pin)
+{
+    const auto now_us = daisy::System::GetUs();
+    for (size_t i = 0; i < _input_count; ++i)
+    {
+        auto& entry = _inputs[i];
+        if (entry.interrupt && (1u << entry.pin.pin) == gpio_pin)
+        {
+            Update(entry, now_us);
+        }
+    }
+}
+
+void SwitchEvents::Update(Input& entry, uint32_t now_us)
+{
+    if ((now_us - entry.changed_us) < debounce_us)
+    {
+        return;
+    }
+
+    const bool pressed = entry.input->RawState();
+    if (pressed == entry.pressed)
+    {
+        return;
+    }
+
+    entry.pressed = pressed;
+    entry.changed_us = now_us;
+
+    const SwitchEvent event{now_us, entry.source, entry.index, pressed};
+    if (entry.source == SwitchEvent::Source::Stomp)
+    {
+        _audio_events.Push(event);
+    }
+    _control_events.Push(event);
+}
+
+extern "C"
+{
+
+void HAL_GPIO_EXTI_Callback(uint16_t gpio_pin)
+{
+    if (interrupt_target != nullptr)
+    {
+        interrupt_target->OnInterrupt(gpio_pin);
+    }
+}
+
+void EXTI0_IRQHandler() { HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_0); }
+void EXTI1_IRQHandler() { HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_1); }
+void EXTI2_IRQHandler() { HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_2); }
+void EXTI3_IRQHandler() { HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_3); }
+void EXTI4_IRQHandler() { HAL_GPIO_EXTI_IRQHandler(GPIO_PIN_4); }
+
+void EXTI9_5_IRQHandler()
+{
+    for (uint32_t pin = GPIO_PIN_5; pin <= GPIO_PIN_9; pin <<= 1)
+    {
+        HAL_GPIO_EXTI_IRQHandler(static_cast<uint16_t>(pin));
+    }
+}
+
+void EXTI15_10_IRQHandler()
+{
+    for (uint32_t pin = GPIO_PIN_10; pin <= GPIO_PIN_15; pin <<= 1)
+    {
+        HAL_GPIO_EXTI_IRQHandler(static_cast<uint16_t>(pin));
+    }
+}
+
+} // extern "C"
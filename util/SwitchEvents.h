@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <daisy_seed.h>
+
+#include <util/EventQueue.h>
+
+struct SwitchEvent
+{
+    enum class Source : uint8_t
+    {
+        Stomp,
+        Toggle,
+    };
+
+    uint32_t time_us;
+    Source source;
+    uint8_t index;
+    bool pressed;
+};
+
+// Interrupt-driven switch edges.
+//
+// Every switch pin is routed to an EXTI line, so an edge is timestamped with
+// System::GetUs() as it happens instead of at the next control tick. The
+// first edge is taken straight away and contact bounce is ignored for
+// debounce_us after it; Poll() picks up the level if it ended up different.
+// Pins that share an EXTI line number with an earlier switch are polled
+// instead.
+//
+// Stomp events go to both queues; toggle events only to the control queue.
+class SwitchEvents
+{
+public:
+    static constexpr size_t max_inputs = 8;
+    static constexpr size_t queue_size = 32;
+    static constexpr uint32_t debounce_us = 10000;
+
+    using Queue = EventQueue<SwitchEvent, queue_size>;
+
+    // Register every switch, then Start() enables the interrupts.
+    void Add(SwitchEvent::Source source, uint8_t index, daisy::Pin pin, daisy::Switch& input);
+    void Start();
+
+    // Call from the control loop.
+    void Poll();
+
+    bool Pressed(SwitchEvent::Source source, uint8_t index) const;
+
+    Queue& AudioEvents() { return _audio_events; }
+    Queue& ControlEvents() { return _control_events; }
+
+    // Called from the EXTI interrupt with the GPIO pin mask.
+    void OnInterrupt(uint16_t gpio_pin);
+
+private:
+    struct Input
+    {
+        SwitchEvent::Source source;
+        uint8_t index;
+        daisy::Pin pin;
+        daisy::Switch* input;
+        bool interrupt;
+        volatile bool pressed;
+        volatile uint32_t changed_us;
+    };
+
+    void Update(Input& input, uint32_t now_us);
+
+    std::array<Input, max_inputs> _inputs{};
+    size_t _input_count = 0;
+    Queue _audio_events;
+    Queue _control_events;
+};
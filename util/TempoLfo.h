@@ -0,0 +1,70 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+// Tempo-synced modulation source evaluated at audio block rate.
+//
+// NextBlock() computes the LFO value at the end of the coming block once;
+// operator() then steps linearly towards it sample by sample, so the
+// per-sample cost is a single add.
+class TempoLfo
+{
+public:
+    void Init(float sample_rate)
+    {
+        _sample_period = 1.0f / sample_rate;
+        _phase = 0.0f;
+        _value = Shape(_phase);
+        _step = 0.0f;
+    }
+
+    void SetPeriodMs(uint32_t period_ms)
+    {
+        _rate_hz = 1000.0f / static_cast<float>(std::max<uint32_t>(period_ms, 1));
+    }
+
+    // Restarts the cycle at the next block, e.g. on a tempo tap.
+    void Sync()
+    {
+        _sync_pending = true;
+    }
+
+    void NextBlock(size_t size)
+    {
+        if (_sync_pending)
+        {
+            _sync_pending = false;
+            _phase = 0.0f;
+        }
+
+        _phase += _rate_hz * _sample_period * static_cast<float>(size);
+        _phase -= std::floor(_phase);
+        _step = (Shape(_phase) - _value) / static_cast<float>(size);
+    }
+
+    // -1..1
+    float operator()()
+    {
+        _value += _step;
+        return _value;
+    }
+
+private:
+    // Parabolic sine approximation: no trig calls, and the shape is smooth
+    // enough that block-rate evaluation with linear steps is inaudible.
+    static float Shape(float phase)
+    {
+        const float t = (2.0f * phase) - 1.0f;
+        return -4.0f * t * (1.0f - std::abs(t));
+    }
+
+    float _sample_period = 1.0f / 48000.0f;
+    float _rate_hz = 2.0f;
+    float _phase = 0.0f;
+    float _value = 0.0f;
+    float _step = 0.0f;
+    volatile bool _sync_pending = false;
+};
@@ -10,16 +10,26 @@ void Terrarium::Init(bool boost, bool oled, bool encoder)
     InitToggles();
     InitStomps();
     InitLeds();
+    switch_events.Start();
+}
 
-    if(display_enabled) {
+bool Terrarium::InitPending()
+{
+    // One step per call so a slow peripheral never stalls a whole loop tick.
+    if(display_enabled && !display_ready) {
         InitDisplay();
+        display_ready = true;
+        return false;
     }
-    if(encoder_enabled) {
+    if(encoder_enabled && !encoder_ready) {
         InitEncoder();
+        encoder_ready = true;
+        return false;
     }
+    return true;
 }
 
-void Terrarium::Loop(float frequency, std::function<void()> callback)
+void Terrarium::Loop(float frequency, std::function<void()> callback, std::function<void()> idle)
 {
     for (auto& knob : knobs)
     {
@@ -31,6 +41,11 @@ void Terrarium::Loop(float frequency, std::function<void()> callback)
     auto wait_begin = daisy::System::GetTick();
     while (true)
     {
+        if (!peripherals_ready)
+        {
+            peripherals_ready = InitPending();
+        }
+
         for (auto& toggle : toggles)
         {
             toggle.Debounce();
@@ -41,23 +56,22 @@ void Terrarium::Loop(float frequency, std::function<void()> callback)
             stomp.Debounce();
         }
 
-        if(encoder_enabled) {
-            const int increment = encoder.Increment();
-            if(increment != 0) {
-                encoder_value += increment;
-            }
+        switch_events.Poll();
 
+        if(encoder_ready) {
             encoder.Debounce();
         }
 
-        if(display_enabled) {
-            // UpdateMenu();
-            display.Update();
-        }
-
         callback();
 
-        while ((daisy::System::GetTick() - wait_begin) < interval) {}
+        // Idle runs at least once per tick, even when the loop is behind.
+        do
+        {
+            if (idle)
+            {
+                idle();
+            }
+        } while ((daisy::System::GetTick() - wait_begin) < interval);
         wait_begin += interval;
     }
 }
@@ -101,6 +115,7 @@ void Terrarium::InitToggles()
     for (int i = 0; i < toggle_count; ++i)
     {
         toggles[i].Init(toggle_pins[i]);
+        switch_events.Add(SwitchEvent::Source::Toggle, i, toggle_pins[i], toggles[i]);
     }
 }
 
@@ -114,6 +129,7 @@ void Terrarium::InitStomps()
     for (int i = 0; i < stomp_count; ++i)
     {
         stomps[i].Init(stomp_pins[i]);
+        switch_events.Add(SwitchEvent::Source::Stomp, i, stomp_pins[i], stomps[i]);
     }
 }
 
@@ -145,24 +161,13 @@ void Terrarium::InitDisplay()
     char welcome_message[128];
     sprintf(welcome_message, "Hello :)");
 
+    // No delay here: the welcome screen stays up until the menu draws over
+    // it, and audio is already running.
     display.WriteStringAligned(welcome_message, Font_11x18, display_bounds, daisy::Alignment::centered, true);
     display.Update();
-    System::Delay(500);
 }
 
 void Terrarium::InitEncoder()
 {
     encoder.Init(daisy::seed::D6, daisy::seed::D5, daisy::seed::D4); //a, b, click
 }
-
-void Terrarium::UpdateMenu()
-{
-    display.Fill(false);
-
-    char encoderval[128];
-    sprintf(encoderval, "Page %d", encoder_value);
-
-    daisy::Rectangle bounds = display.GetBounds();
-
-    display.WriteStringAligned(encoderval, Font_11x18, bounds, daisy::Alignment::centered, true);
-}
\ No newline at end of file
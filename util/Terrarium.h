@@ -6,7 +6,8 @@
 #include <daisy_seed.h>
 
 #include <util/Led.h>
-#include <util/RiskierEncoder.h>
+#include <util/QuadratureEncoder.h>
+#include <util/SwitchEvents.h>
 
 #include <dev/oled_ssd130x.h>
 
@@ -16,16 +17,25 @@ using I2COledDisplay = daisy::OledDisplay<daisy::SSD130xI2c128x64Driver>;
 class Terrarium
 {
 public:
-    // Initializes the Daisy Seed hardware and the Terrarium interface.
+    // Initializes the Daisy Seed hardware and the Terrarium controls.
     // Call this method before using other members of this class.
+    // Only the peripherals needed to start audio are brought up here; the
+    // display and encoder are initialized in the background by Loop().
     void Init(bool boost = false, bool oled = false, bool encoder = false);
 
+    // Runs the next pending background init step, if any.
+    // Returns true once every requested peripheral is initialized.
+    bool InitPending();
+
     // Start an infinite loop that executes at the given frequency in hertz.
     // Sets the Terrarium knob sample rates to match the loop frequency.
-    // Automatically debounces the Terrarium toggle and stomp switches.
-    void Loop(float frequency, std::function<void()> callback);
+    // Automatically debounces the Terrarium toggle and stomp switches and
+    // polls switch_events. The optional idle callback runs repeatedly while
+    // the loop waits for its next tick, and at least once per tick.
+    [[noreturn]] void Loop(float frequency, std::function<void()> callback, std::function<void()> idle = {});
 
-    void UpdateMenu();
+    bool DisplayReady() const { return display_ready; }
+    bool EncoderReady() const { return encoder_ready; }
 
     daisy::DaisySeed seed;
 
@@ -38,16 +48,19 @@ public:
     std::array<daisy::Switch, toggle_count> toggles;
     std::array<daisy::Switch, stomp_count> stomps;
     std::array<TerrariumLed, led_count> leds;
+    // Timestamped edges of the toggles and stomps, from interrupts.
+    SwitchEvents switch_events;
     I2COledDisplay display;
-    RiskierEncoder encoder;
+    // Turns are counted in the background; Loop() debounces the click.
+    QuadratureEncoder encoder;
     daisy::Rectangle display_bounds;
 
-    int encoder_value = 0;
-    int encoder_value_limit = 2;
-
 private:
     bool display_enabled = false;
     bool encoder_enabled = false;
+    bool display_ready = false;
+    bool encoder_ready = false;
+    bool peripherals_ready = false;
 
     void InitKnobs();
     void InitToggles();
@@ -55,5 +68,4 @@ private:
     void InitLeds();
     void InitDisplay();
     void InitEncoder();
-    void InitMenu();
 };
\ No newline at end of file
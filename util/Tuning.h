@@ -0,0 +1,20 @@
+#pragma once
+
+#include <util/LoopDesign.h>
+
+// PLL parameters the panel doesn't reach, set per guitar from the encoder
+// menu and stored with the settings. The defaults are the values the
+// firmware used before they were tunable.
+struct Tuning
+{
+    // The loop as a LoopDesign; the error filter keeps its default ratio.
+    float loop_natural_hz = LoopDesign{}.natural_hz;
+    float loop_damping = LoopDesign{}.damping;
+    float loop_lock_range_hz = LoopDesign{}.lock_range_hz;
+    float fll_gain = 0.5f;
+    float trigger_ratio = 0.3f;
+    float wave_shape = 1.0f;
+    float sub_wave_shape = 1.0f;
+    float wah_tracking_ratio = 1.15f;
+    float wah_q_max = 6.0f;
+};
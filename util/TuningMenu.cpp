@@ -0,0 +1,111 @@
+#include "TuningMenu.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace
+{
+
+// Fixed point, since the firmware's printf has no float support.
+void FormatValue(char* text, size_t size, float value, int decimals, const char* unit)
+{
+    long scale = 1;
+    for (int i = 0; i < decimals; ++i)
+    {
+        scale *= 10;
+    }
+    const long scaled = std::lround(value * static_cast<float>(scale));
+    if (decimals == 0)
+    {
+        snprintf(text, size, "%ld%s", scaled, unit);
+        return;
+    }
+    snprintf(text, size, "%ld.%0*ld%s", scaled / scale, decimals, std::labs(scaled % scale), unit);
+}
+
+} // namespace
+
+// Ranges are the ones PLL::SetParams() clamps to. The loop ranges keep the
+// designed gains inside its Kp and Ki limits.
+const std::array<TuningMenu::Item, 9> TuningMenu::items{{
+    {"Loop freq", &Tuning::loop_natural_hz, 5.0f, 40.0f, 0.5f, 1, " Hz"},
+    {"Damping", &Tuning::loop_damping, 0.4f, 1.5f, 0.02f, 2, ""},
+    {"Lock range", &Tuning::loop_lock_range_hz, 20.0f, 800.0f, 10.0f, 0, " Hz"},
+    {"FLL gain", &Tuning::fll_gain, 0.0f, 1.0f, 0.05f, 2, ""},
+    {"Trigger", &Tuning::trigger_ratio, 0.0f, 1.0f, 0.01f, 2, ""},
+    {"Osc wave", &Tuning::wave_shape, 0.0f, 3.0f, 0.05f, 2, ""},
+    {"Sub wave", &Tuning::sub_wave_shape, 0.0f, 3.0f, 0.05f, 2, ""},
+    {"Wah track", &Tuning::wah_tracking_ratio, 0.5f, 4.0f, 0.05f, 2, "x"},
+    {"Wah Q", &Tuning::wah_q_max, 1.2f, 12.0f, 0.2f, 1, ""},
+}};
+
+bool TuningMenu::Process(int detents, bool click, Tuning& tuning)
+{
+    if (click)
+    {
+        if (_editing && _edited)
+        {
+            _save_requested = true;
+        }
+        _editing = !_editing;
+        _edited = false;
+        _dirty = true;
+    }
+
+    if (detents == 0)
+    {
+        return false;
+    }
+    _dirty = true;
+
+    if (!_editing)
+    {
+        const auto count = static_cast<int>(items.size());
+        _selected = static_cast<size_t>((((static_cast<int>(_selected) + detents) % count) + count) % count);
+        return false;
+    }
+
+    const auto& item = items[_selected];
+    float& value = tuning.*item.value;
+    const float stepped = std::clamp(value + (static_cast<float>(detents) * item.step), item.min, item.max);
+    if (stepped == value)
+    {
+        return false;
+    }
+    value = stepped;
+    _edited = true;
+    return true;
+}
+
+bool TuningMenu::TakeSaveRequest()
+{
+    const bool requested = _save_requested;
+    _save_requested = false;
+    return requested;
+}
+
+void TuningMenu::Draw(I2COledDisplay& display, const Tuning& tuning)
+{
+    if (!_dirty)
+    {
+        return;
+    }
+    _dirty = false;
+
+    const auto& item = items[_selected];
+    char title[32];
+    snprintf(title, sizeof(title), "%u/%u %s",
+        static_cast<unsigned>(_selected + 1), static_cast<unsigned>(items.size()), item.name);
+
+    char value[24];
+    FormatValue(value, sizeof(value), tuning.*item.value, item.decimals, item.unit);
+    char line[32];
+    snprintf(line, sizeof(line), _editing ? "> %s <" : "%s", value);
+
+    display.Fill(false);
+    display.WriteStringAligned(title, Font_7x10, daisy::Rectangle{0, 0, 128, 16}, daisy::Alignment::centered, true);
+    display.WriteStringAligned(line, Font_11x18, daisy::Rectangle{0, 24, 128, 40}, daisy::Alignment::centered, true);
+    display.Update();
+}
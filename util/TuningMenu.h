@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+#include <util/Terrarium.h>
+#include <util/Tuning.h>
+
+// Encoder menu for the Tuning values.
+//
+// Turning steps through the parameters; a click starts editing the one
+// shown, turning then changes it live, and another click ends the edit.
+// The tuning is only stored once an edit ends, not on every detent, to
+// spare the flash.
+//
+// Writing the screen out over I2C takes far longer than a control tick, so
+// Draw() only renders and sends a frame when something on it changed.
+class TuningMenu
+{
+public:
+    struct Item
+    {
+        const char* name;
+        float Tuning::*value;
+        float min;
+        float max;
+        float step;
+        // Digits after the decimal point on screen.
+        int decimals;
+        const char* unit;
+    };
+
+    static const std::array<Item, 9> items;
+
+    // Returns true when a tuning value changed.
+    bool Process(int detents, bool click, Tuning& tuning);
+
+    // True once after an edit that changed something ended.
+    bool TakeSaveRequest();
+
+    void Draw(I2COledDisplay& display, const Tuning& tuning);
+
+private:
+    size_t _selected = 0;
+    bool _editing = false;
+    bool _edited = false;
+    bool _save_requested = false;
+    bool _dirty = true;
+};